@@ -1,8 +1,17 @@
 mkdir -f build | out-null
 cp raylib/raylib.dll .
 
+if ($args[0] -eq "pack" -or $args[0] -eq "web") {
+    clang -I./raylib -L./raylib -lraylib -o pack.exe pack.c
+    ./pack.exe assets.pak (Get-ChildItem ./assets -File | ForEach-Object { "./assets/" + $_.Name })
+}
+
 if ($args[0] -eq "web") {
-    emcc -o ./build/game.html main.c -Os -Wall ./raylib/libraylib.a -I./arena -I./raylib -L./raylib -s USE_GLFW=3 -DPLATFORM_WEB -std=c23 --shell-file ./raylib/minshell.html --preload-file=./assets/
-} else {
-	clang -MJ compile_commands.json -I./arena -I./raylib -L./raylib -lraylib -o main.exe main.c
+    $music = if (Test-Path ./assets/music) { "--preload-file=./assets/music" }
+    emcc -o ./build/game.html main.c -Os -Wall ./raylib/libraylib.a -I./arena -I./raylib -L./raylib -s USE_GLFW=3 -DPLATFORM_WEB -std=c23 --shell-file ./raylib/minshell.html --preload-file=./assets.pak --preload-file=./assets/sprites.txt $music
+} elseif ($args[0] -eq "bench") {
+    clang -O2 -DBench -I./arena -I./raylib -L./raylib -lraylib -o bench.exe main.c
+    ./bench.exe
+} elseif ($args[0] -ne "pack") {
+	clang -MJ compile_commands.json -O2 -I./arena -I./raylib -L./raylib -lraylib -o main.exe main.c
 }
\ No newline at end of file
@@ -1,13 +1,30 @@
 #define ARENA_IMPLEMENTATION
+#include "pack.h"
 #include <arena.h>
 #include <math.h>
 #include <raylib.h>
 #include <raymath.h>
+#include <rlgl.h>
+#include <stdalign.h>
+#include <stdatomic.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 #if defined(PLATFORM_WEB)
 #include <emscripten/emscripten.h>
+#else
+#include <threads.h>
+#define HAS_THREADS
+#endif
+
+#if !defined(PLATFORM_WEB) && (defined(__unix__) || defined(__APPLE__))
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define HAS_MMAP
 #endif
 
 static Arena arena = {0};
@@ -19,473 +36,4365 @@ float Approach(float current, float target, float increase) {
     return fmax(current - increase, target);
 }
 
-typedef int32_t TextureID;
-int32_t texture_cnt = 0;
-#define MAX_TEX 5
-Texture2D textures[MAX_TEX];
+#define MAX_FRAME_TIME 0.1f
 
-TextureID add_tex(const char *path) {
-    TextureID id = texture_cnt++;
-    textures[id] = LoadTexture(path);
-    return id;
+// Menu screens sleep until input arrives, so the first frame after them can report a very long frame time.
+float frame_time(void) {
+    return fminf(GetFrameTime(), MAX_FRAME_TIME);
 }
 
-Texture2D get_tex(TextureID id) {
-    return textures[id];
+bool rect_contains(Rectangle outer, Rectangle inner) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+           inner.x + inner.width <= outer.x + outer.width &&
+           inner.y + inner.height <= outer.y + outer.height;
 }
 
-static Sound land;
-static Sound jump;
-static Sound pickup;
+// :pack
+// Assets come from assets.pak when it exists (see pack.c), loose files are the fallback for development.
+#define PACK_PATH "./assets.pak"
 
-typedef struct Animation {
-    TextureID tex;
-    float speed;
-    int frame_cnt;
-    float timer;
-    int current_frame;
-} Animation;
+typedef struct Pack {
+    unsigned char *data;
+    size_t size;
+    bool mapped;
+    PackHeader *header;
+    PackEntry *entries;
+} Pack;
 
-void update_anim(Animation *anim, float dt) {
-    anim->timer += dt;
-    if (anim->timer > anim->speed) {
-        anim->current_frame++;
-        anim->timer = 0;
-        if (anim->current_frame >= anim->frame_cnt) {
-            anim->current_frame = 0;
-        }
-    }
-}
+static Pack pack = {0};
 
-void reset_anim(Animation *anim) {
-    anim->current_frame = 0;
-    anim->timer = 0;
+void pack_close(Pack *p) {
+    if (!p->data) {
+        return;
+    }
+#ifdef HAS_MMAP
+    if (p->mapped) {
+        munmap(p->data, p->size);
+    }
+#endif
+    if (!p->mapped) {
+        UnloadFileData(p->data);
+    }
+    *p = (Pack){0};
 }
-// :en
-typedef enum EntityProp {
-    EP_NIL,
-    EP_COLLIDABLE,
-    EP_RIDABLE,
-    EP_PLAT,
-} EntityProp;
-
-typedef enum EntityId {
-    EID_NIL,
-    EID_CHUNK,
-    EID_DEAD_ZONE,
-    EID_MOVING_PLAT,
-    EID_PLAT,
-    EID_JUMP_COFFEE,
-    EID_CHECK_COFFEE,
-    EID_PLAYER,
-    EID_TROPHY,
-    // :id
-} EntityId;
 
-#define MAX_PROPS 10
-typedef struct Entity {
-    Vector2 pos;
-    Vector2 vel;
-    Vector2 remainder;
-    Vector2 size;
-    Rectangle aabb;
-    bool flip;
-    struct Entity *last_collided;
-    bool is_collidable;
-    int32_t prop_cnt;
-    EntityProp *props;
-    bool grounded;
-    EntityId id;
-    Vector2 respawn;
-    TextureID texId;
-    bool is_valid;
-    bool played_land;
-    float fall_time;
-    void *user_data;
-} Entity;
+bool pack_open(Pack *p, const char *path) {
+    *p = (Pack){0};
+#ifdef HAS_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return false;
+    }
+    void *mem = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mem == MAP_FAILED) {
+        return false;
+    }
+    p->data = mem;
+    p->size = st.st_size;
+    p->mapped = true;
+#else
+    if (!FileExists(path)) {
+        return false;
+    }
+    int size = 0;
+    p->data = LoadFileData(path, &size);
+    p->size = size;
+    if (!p->data) {
+        return false;
+    }
+#endif
 
-void en_setup(Entity *en, float x, float y, float w, float h) {
-    en->vel = (Vector2){0, 0};
-    en->remainder = (Vector2){0, 0};
-    en->pos = (Vector2){x, y};
-    en->size = (Vector2){w, h};
-    en->aabb = (Rectangle){x, y, w, h};
-    en->is_valid = true;
-    en->played_land = true;
-    en->props = arena_alloc(&arena, sizeof(EntityProp) * MAX_PROPS);
-    memset(en->props, 0, sizeof(EntityProp) * MAX_PROPS);
+    p->header = (PackHeader *)p->data;
+    p->entries = (PackEntry *)(p->data + sizeof(PackHeader));
+    if (p->size < sizeof(PackHeader) || p->header->magic != PACK_MAGIC || p->header->version != PACK_VERSION ||
+        sizeof(PackHeader) + (size_t)p->header->entry_cnt * sizeof(PackEntry) > p->size) {
+        TraceLog(LOG_WARNING, "pack: %s is not a valid bundle, loading loose files", path);
+        pack_close(p);
+        return false;
+    }
+    for (uint32_t i = 0; i < p->header->entry_cnt; i++) {
+        PackEntry *e = &p->entries[i];
+        if ((size_t)e->offset + e->size > p->size) {
+            TraceLog(LOG_WARNING, "pack: entry %s points outside of %s, loading loose files", e->path, path);
+            pack_close(p);
+            return false;
+        }
+    }
+    return true;
 }
 
-void en_add_props(Entity *en, EntityProp prop) {
-    en->props[en->prop_cnt++] = prop;
+PackEntry *pack_find(Pack *p, const char *path, PackKind kind) {
+    if (!p->data) {
+        return NULL;
+    }
+    for (uint32_t i = 0; i < p->header->entry_cnt; i++) {
+        PackEntry *e = &p->entries[i];
+        if (e->kind == kind && strncmp(e->path, path, PACK_PATH_LEN) == 0) {
+            return e;
+        }
+    }
+    return NULL;
 }
 
-bool en_has_prop(Entity *en, EntityProp prop) {
-    if (en->prop_cnt <= 0)
+// Points `img` at the pixels stored in the bundle, nothing is copied or decoded.
+bool pack_image(Pack *p, const char *path, Image *img) {
+    PackEntry *e = pack_find(p, path, PK_TEXTURE);
+    if (!e) {
         return false;
-    for (int i = 0; i < MAX_PROPS; i++) {
-        if (en->props[i] == prop)
-            return true;
     }
-    return false;
+    *img = (Image){
+        .data = p->data + e->offset,
+        .width = e->tex.width,
+        .height = e->tex.height,
+        .mipmaps = 1,
+        .format = e->tex.format,
+    };
+    return true;
 }
 
-bool en_collides_with(Entity *en, Entity **collidables, size_t collidables_len, Vector2 at) {
-    Rectangle to_check = {at.x, at.y, en->aabb.width, en->aabb.height};
-    for (int i = 0; i < collidables_len; i++) {
-        Entity *c = collidables[i];
-        if (CheckCollisionRecs(c->aabb, to_check)) {
-            en->last_collided = c;
-            return true;
-        }
+bool pack_wave(Pack *p, const char *path, Wave *wave) {
+    PackEntry *e = pack_find(p, path, PK_SOUND);
+    if (!e) {
+        return false;
     }
-    return false;
+    *wave = (Wave){
+        .frameCount = e->snd.frame_cnt,
+        .sampleRate = e->snd.sample_rate,
+        .sampleSize = e->snd.sample_size,
+        .channels = e->snd.channels,
+        .data = p->data + e->offset,
+    };
+    return true;
 }
+// ;pack
 
-typedef void (*Action)(Entity *);
+// :assets
+// Textures and sounds live in one growable registry keyed by path. Acquiring a path twice returns the same id and
+// bumps its reference count, ids stay valid across reloads so callers can hold on to them.
+#define ASSET_POLL_INTERVAL 0.5f
 
-int signd(int x) {
-    return (x > 0) - (x < 0);
+typedef int32_t AssetID;
+typedef AssetID TextureID;
+typedef AssetID SoundID;
+
+typedef enum AssetKind {
+    AK_TEXTURE,
+    AK_SOUND,
+} AssetKind;
+
+typedef struct Asset {
+    AssetKind kind;
+    char *path;
+    int32_t refs;
+    bool ready;
+    long mtime;
+    uint32_t rev;
+    union {
+        Texture2D tex;
+        Sound snd;
+    };
+} Asset;
+
+typedef struct Assets {
+    Asset *items;
+    int32_t cnt;
+    int32_t cap;
+    float poll_timer;
+    void (*on_unload)(AssetID id);
+} Assets;
+
+static Assets assets = {0};
+
+Texture2D get_tex(TextureID id) {
+    return assets.items[id].tex;
 }
 
-void ActorMoveX(Entity **collidables, size_t collidables_len, Entity *e, float amount, Action callback) {
-    e->remainder.x += amount;
-    int move = round(e->remainder.x);
-    if (move != 0) {
-        e->remainder.x -= move;
-        int sign = signd(move);
-        while (move != 0) {
-            if (!en_collides_with(e, collidables, collidables_len, (Vector2){e->pos.x + sign, e->pos.y})) {
-                e->pos.x += sign;
-                move -= sign;
-            } else {
-                if (callback) {
-                    callback(e);
-                }
-                if (e->last_collided && !e->last_collided->is_collidable) {
-                    e->pos.x += sign;
-                    move -= sign;
-                } else {
-                    break;
-                }
-            }
+Sound get_sound(SoundID id) {
+    return assets.items[id].snd;
+}
+
+AssetID assets_find(Assets *reg, AssetKind kind, const char *path) {
+    for (int32_t i = 0; i < reg->cnt; i++) {
+        if (reg->items[i].kind == kind && strcmp(reg->items[i].path, path) == 0) {
+            return i;
         }
     }
+    return -1;
 }
 
-void ActorMoveY(Entity **collidables, size_t collidables_len, Entity *e, float amount, Action callback) {
-    e->remainder.y += amount;
-    int move = round(e->remainder.y);
-    if (move != 0) {
-        e->remainder.y -= move;
-        int sign = signd(move);
-        while (move != 0) {
-            if (!en_collides_with(e, collidables, collidables_len, (Vector2){e->pos.x, e->pos.y + sign})) {
-                e->pos.y += sign;
-                move -= sign;
-            } else {
-                if (callback) {
-                    callback(e);
-                }
-                if (e->last_collided != NULL && !e->last_collided->is_collidable) {
-                    e->pos.y += sign;
-                    move -= sign;
-                } else {
-                    if (e->vel.y > 0) {
-                        if (!e->played_land) {
-                            PlaySound(land);
-                            e->played_land = true;
-                        }
-                        e->grounded = true;
-                        e->fall_time = 0;
-                    }
-                    e->vel.y = 0;
-                    break;
-                }
-            }
-        }
+AssetID assets_add(Assets *reg, AssetKind kind, const char *path) {
+    if (reg->cnt == reg->cap) {
+        int32_t new_cap = reg->cap ? reg->cap * 2 : 16;
+        reg->items = arena_realloc(&arena, reg->items, reg->cap * sizeof(Asset), new_cap * sizeof(Asset));
+        reg->cap = new_cap;
     }
+    AssetID id = reg->cnt++;
+    Asset *a = &reg->items[id];
+    memset(a, 0, sizeof(Asset));
+    a->kind = kind;
+    a->path = arena_alloc(&arena, strlen(path) + 1);
+    strcpy(a->path, path);
+    a->mtime = GetFileModTime(path);
+    return id;
 }
 
-typedef enum Screen {
-    S_MENU,
-    S_GAME,
-    S_LOST,
-    S_WON,
-    S_CREDITS,
-    S_DIFFICULTY,
-    S_HOWTO,
-} Screen;
+void asset_unload(Assets *reg, AssetID id) {
+    Asset *a = &reg->items[id];
+    if (!a->ready) {
+        return;
+    }
+    if (reg->on_unload) {
+        reg->on_unload(id);
+    }
+    switch (a->kind) {
+    case AK_TEXTURE:
+        UnloadTexture(a->tex);
+        break;
+    case AK_SOUND:
+        UnloadSound(a->snd);
+        break;
+    }
+    a->ready = false;
+}
 
-#define MAX_ENTITIES 1024
-typedef struct Game {
-    Screen screen;
-    size_t en_cnt;
-    Entity **ens;
-} Game;
+void asset_load_now(Asset *a) {
+    switch (a->kind) {
+    case AK_TEXTURE:
+        a->tex = LoadTexture(a->path);
+        break;
+    case AK_SOUND:
+        a->snd = LoadSound(a->path);
+        break;
+    }
+    a->ready = true;
+    a->rev++;
+}
+// ;assets
 
-static Game game = {0};
+// :load
+// Decoding (or pointing into the bundle) happens on worker threads together with opening the bundle and the audio
+// device, the main thread only uploads finished jobs to the GPU / mixer while the loading screen is up.
+#define MAX_LOAD_JOBS 16
+#define LOAD_WORKERS 3
+#define LOAD_UPLOAD_BUDGET 0.004
 
-// :player
-typedef enum PlayerState {
-    PS_IDLE,
-    PS_WALK,
-} PlayerState;
+typedef enum LoadState {
+    LS_QUEUED,
+    LS_DECODED,
+    LS_FAILED,
+    LS_DONE,
+} LoadState;
 
-typedef struct Player {
-    Animation *animation;
-    PlayerState state;
-    PlayerState prevState;
-    float jump_power;
-    float jump_boost_time;
-} Player;
+typedef struct LoadJob {
+    AssetKind kind;
+    const char *path;
+    AssetID id;
+    Image img;
+    Wave wave;
+    bool owned;
+    atomic_int state;
+} LoadJob;
 
-Entity *player_init() {
-    Entity *e = arena_alloc(&arena, sizeof(Entity));
-    memset(e, 0, sizeof(Entity));
-    en_setup(e, 0, -24, 18, 24);
-    e->user_data = arena_alloc(&arena, sizeof(Player));
-    Player *data = (Player *)e->user_data;
-    data->state = PS_IDLE;
-    data->jump_power = -5;
-    e->id = EID_PLAYER;
-    return e;
+typedef struct Loader {
+    LoadJob jobs[MAX_LOAD_JOBS];
+    int job_cnt;
+    int done_cnt;
+    atomic_int next;
+    atomic_bool audio_ready;
+    bool running;
+    bool finished;
+    bool threaded;
+#ifdef HAS_THREADS
+    thrd_t boot;
+    thrd_t workers[LOAD_WORKERS];
+#endif
+} Loader;
+
+static Loader loader = {0};
+
+// Jobs can only be queued before the loader starts, later requests are loaded on the spot by the registry.
+bool loader_queue(Loader *l, AssetKind kind, const char *path, AssetID id) {
+    if (l->running || l->finished || l->job_cnt == MAX_LOAD_JOBS) {
+        return false;
+    }
+    LoadJob *job = &l->jobs[l->job_cnt++];
+    job->kind = kind;
+    job->path = path;
+    job->id = id;
+    atomic_store(&job->state, LS_QUEUED);
+    return true;
 }
-void onCollide(Entity *self) {
-    Player *data = (Player *)self->user_data;
-    if (self->last_collided) {
-        if (self->last_collided->id == EID_DEAD_ZONE) {
-            if (data->jump_boost_time <= 0) {
-                game.screen = S_LOST;
-            } else {
-                self->pos = self->respawn;
-            }
-        } else if (self->last_collided->id == EID_JUMP_COFFEE) {
-            self->last_collided->is_valid = false;
-            data->jump_power = -10;
-            data->jump_boost_time = Clamp(data->jump_boost_time, data->jump_boost_time + 4, 20);
-            PlaySound(pickup);
-        } else if (self->last_collided->id == EID_CHECK_COFFEE) {
-            self->respawn = (Vector2){self->pos.x, (self->pos.y + self->aabb.height - self->aabb.height)};
-            self->last_collided->is_valid = false;
-            PlaySound(pickup);
-        } else if (self->last_collided->id == EID_TROPHY) {
-            game.screen = S_WON;
+
+void load_job_decode(LoadJob *job) {
+    bool ok = false;
+    switch (job->kind) {
+    case AK_TEXTURE:
+        job->owned = !pack_image(&pack, job->path, &job->img);
+        if (job->owned) {
+            job->img = LoadImage(job->path);
+        }
+        ok = IsImageReady(job->img);
+        break;
+    case AK_SOUND:
+        job->owned = !pack_wave(&pack, job->path, &job->wave);
+        if (job->owned) {
+            job->wave = LoadWave(job->path);
         }
+        ok = IsWaveReady(job->wave);
+        break;
     }
+    atomic_store(&job->state, ok ? LS_DECODED : LS_FAILED);
 }
 
-void player_update(Entity *player, Animation *walk, Animation *idle) {
-    player->aabb.x = player->pos.x + 4;
-    player->aabb.y = player->pos.y;
-    Player *data = (Player *)player->user_data;
+int loader_worker(void *arg) {
+    Loader *l = arg;
+    for (;;) {
+        int i = atomic_fetch_add(&l->next, 1);
+        if (i >= l->job_cnt) {
+            return 0;
+        }
+        load_job_decode(&l->jobs[i]);
+    }
+}
 
-    if (IsKeyDown(KEY_A)) {
-        walk->speed = Approach(walk->speed, .1, 4 * GetFrameTime());
-        player->vel.x = Approach(player->vel.x, -2.0, 22 * GetFrameTime());
-        player->flip = true;
-        data->state = PS_WALK;
-    } else if (IsKeyDown(KEY_D)) {
-        walk->speed = Approach(walk->speed, .1, 4 * GetFrameTime());
-        player->vel.x = Approach(player->vel.x, 2.0, 22 * GetFrameTime());
-        player->flip = false;
-        data->state = PS_WALK;
+#ifdef HAS_THREADS
+int loader_boot(void *arg) {
+    Loader *l = arg;
+    pack_open(&pack, PACK_PATH);
+    int started = 0;
+    for (int i = 0; i < LOAD_WORKERS; i++) {
+        if (thrd_create(&l->workers[i], loader_worker, l) == thrd_success) {
+            started++;
+        }
+    }
+    InitAudioDevice();
+    atomic_store(&l->audio_ready, true);
+    loader_worker(l);
+    for (int i = 0; i < started; i++) {
+        thrd_join(l->workers[i], NULL);
+    }
+    return 0;
+}
+#endif
+
+void loader_start(Loader *l) {
+    l->running = true;
+#ifdef HAS_THREADS
+    l->threaded = thrd_create(&l->boot, loader_boot, l) == thrd_success;
+#endif
+}
+
+void load_job_upload(LoadJob *job) {
+    Asset *a = &assets.items[job->id];
+    if (atomic_load(&job->state) == LS_FAILED) {
+        TraceLog(LOG_WARNING, "load: failed to load %s", job->path);
+    } else if (a->refs == 0 || a->ready) {
+        // Released before the upload, or loaded again synchronously by a later acquire.
+        if (job->owned && job->kind == AK_TEXTURE) {
+            UnloadImage(job->img);
+        } else if (job->owned) {
+            UnloadWave(job->wave);
+        }
+    } else if (job->kind == AK_TEXTURE) {
+        a->tex = LoadTextureFromImage(job->img);
+        a->ready = true;
+        if (job->owned) {
+            UnloadImage(job->img);
+        }
     } else {
-        data->state = PS_IDLE;
+        a->snd = LoadSoundFromWave(job->wave);
+        a->ready = true;
+        if (job->owned) {
+            UnloadWave(job->wave);
+        }
     }
+    a->rev++;
+    atomic_store(&job->state, LS_DONE);
+}
 
-    if (IsKeyPressed(KEY_SPACE) && player->grounded) {
-        player->grounded = false;
-        player->played_land = false;
-        player->vel.y = data->jump_power;
-        PlaySound(jump);
+// Closing the window mid-load must not tear the audio device down under the boot thread.
+void loader_wait(Loader *l) {
+#ifdef HAS_THREADS
+    if (l->threaded) {
+        thrd_join(l->boot, NULL);
+        l->threaded = false;
     }
+#endif
+}
 
-    if (data->prevState != data->state) {
-        switch (data->state) {
-        case PS_IDLE:
-            data->animation = idle;
-            reset_anim(walk);
-            walk->speed = .25;
-            break;
-        case PS_WALK:
-            data->animation = walk;
-            reset_anim(idle);
-            break;
-        default:
-            break;
+// Without threads (the web build) the same work is done here, one job per frame, so the loading screen still shows
+// up immediately. Returns true once everything is uploaded.
+bool loader_update(Loader *l) {
+    if (l->finished) {
+        return true;
+    }
+    if (!l->threaded) {
+        if (!atomic_load(&l->audio_ready)) {
+            pack_open(&pack, PACK_PATH);
+            InitAudioDevice();
+            atomic_store(&l->audio_ready, true);
+            return false;
+        }
+        int i = atomic_fetch_add(&l->next, 1);
+        if (i < l->job_cnt) {
+            load_job_decode(&l->jobs[i]);
         }
-        data->prevState = data->state;
     }
 
-    if (!IsKeyDown(KEY_A) && !IsKeyDown(KEY_D)) {
-        if (player->grounded) {
-            player->vel.x = Approach(player->vel.x, 0.0, 10 * GetFrameTime());
-        } else {
-            player->vel.x = Approach(player->vel.x, 0.0, 12 * GetFrameTime());
+    double start = GetTime();
+    bool audio_ready = atomic_load(&l->audio_ready);
+    for (int i = 0; i < l->job_cnt && GetTime() - start < LOAD_UPLOAD_BUDGET; i++) {
+        LoadJob *job = &l->jobs[i];
+        int state = atomic_load(&job->state);
+        if (state == LS_QUEUED || state == LS_DONE || (job->kind == AK_SOUND && !audio_ready)) {
+            continue;
         }
+        load_job_upload(job);
+        l->done_cnt++;
     }
 
-    size_t collidables_len = 0;
-    Entity *collidables[MAX_ENTITIES];
+    if (l->done_cnt < l->job_cnt || !audio_ready) {
+        return false;
+    }
+    loader_wait(l);
+    pack_close(&pack);
+    l->running = false;
+    l->finished = true;
+    return true;
+}
 
-    for (int i = 0; i < game.en_cnt; i++) {
-        Entity *c = game.ens[i];
-        if (!c->is_valid) {
-            continue;
-        }
-        bool hasProp = en_has_prop(c, EP_COLLIDABLE);
-        if (c && hasProp) {
-            collidables[collidables_len++] = c;
+float loader_progress(Loader *l) {
+    return l->job_cnt ? (float)l->done_cnt / l->job_cnt : 1;
+}
+// ;load
+
+// :assets
+AssetID asset_acquire(AssetKind kind, const char *path) {
+    AssetID id = assets_find(&assets, kind, path);
+    if (id >= 0) {
+        Asset *a = &assets.items[id];
+        if (a->refs++ == 0 && !a->ready) {
+            asset_load_now(a);
+        }
+        return id;
+    }
+    id = assets_add(&assets, kind, path);
+    Asset *a = &assets.items[id];
+    a->refs = 1;
+    if (!loader_queue(&loader, kind, a->path, id)) {
+        asset_load_now(a);
+    }
+    return id;
+}
+
+TextureID tex_acquire(const char *path) {
+    return asset_acquire(AK_TEXTURE, path);
+}
+
+SoundID sound_acquire(const char *path) {
+    return asset_acquire(AK_SOUND, path);
+}
+
+// The last release unloads the data but keeps the slot, acquiring the path again reloads it under the same id.
+void asset_release(AssetID id) {
+    Asset *a = &assets.items[id];
+    if (a->refs > 0 && --a->refs == 0) {
+        asset_unload(&assets, id);
+    }
+}
+
+int32_t assets_referenced(Assets *reg) {
+    int32_t cnt = 0;
+    for (int32_t i = 0; i < reg->cnt; i++) {
+        cnt += reg->items[i].refs > 0;
+    }
+    return cnt;
+}
+
+// Dev mode: polls the modification time of every loaded asset and swaps the new data in under the same id. Textures
+// of the same size are updated in place, anything else is unloaded and loaded again.
+void assets_hot_reload(Assets *reg, float dt) {
+    reg->poll_timer -= dt;
+    if (reg->poll_timer > 0) {
+        return;
+    }
+    reg->poll_timer = ASSET_POLL_INTERVAL;
+
+    for (int32_t i = 0; i < reg->cnt; i++) {
+        Asset *a = &reg->items[i];
+        if (!a->ready) {
+            continue;
+        }
+        long mtime = GetFileModTime(a->path);
+        if (mtime == a->mtime) {
+            continue;
+        }
+        a->mtime = mtime;
+        if (a->kind == AK_TEXTURE) {
+            Image img = LoadImage(a->path);
+            if (!IsImageReady(img)) {
+                continue;
+            }
+            if (img.width == a->tex.width && img.height == a->tex.height) {
+                ImageFormat(&img, a->tex.format);
+                UpdateTexture(a->tex, img.data);
+            } else {
+                UnloadTexture(a->tex);
+                a->tex = LoadTextureFromImage(img);
+            }
+            UnloadImage(img);
+        } else {
+            Wave wave = LoadWave(a->path);
+            if (!IsWaveReady(wave)) {
+                continue;
+            }
+            if (reg->on_unload) {
+                reg->on_unload(i);
+            }
+            UnloadSound(a->snd);
+            a->snd = LoadSoundFromWave(wave);
+            UnloadWave(wave);
+        }
+        a->rev++;
+        TraceLog(LOG_WARNING, "assets: reloaded %s", a->path);
+    }
+}
+// ;assets
+
+// :latency
+// Trigger-to-mix latency: the time from a gameplay trigger to the audio callback that first mixes the triggered voice.
+// Written from the audio thread only, read by the debug overlay and reported on exit.
+typedef struct LatencyStats {
+    atomic_ullong count;
+    atomic_ullong sum_us;
+    atomic_ullong max_us;
+    atomic_ullong last_us;
+} LatencyStats;
+
+static LatencyStats latency = {0};
+
+unsigned long long time_us(void) {
+    return GetTime() * 1e6;
+}
+
+void latency_record(LatencyStats *s, unsigned long long trigger_us) {
+    unsigned long long now = time_us();
+    unsigned long long us = now > trigger_us ? now - trigger_us : 0;
+    atomic_store(&s->last_us, us);
+    atomic_fetch_add(&s->sum_us, us);
+    if (us > atomic_load(&s->max_us)) {
+        atomic_store(&s->max_us, us);
+    }
+    atomic_fetch_add(&s->count, 1);
+}
+
+void latency_reset(LatencyStats *s) {
+    atomic_store(&s->count, 0);
+    atomic_store(&s->sum_us, 0);
+    atomic_store(&s->max_us, 0);
+    atomic_store(&s->last_us, 0);
+}
+
+void latency_report(LatencyStats *s) {
+    unsigned long long cnt = atomic_load(&s->count);
+    if (cnt) {
+        printf("audio latency: %.1f ms avg, %.1f ms max over %llu sounds\n", atomic_load(&s->sum_us) / 1000.0 / cnt,
+               atomic_load(&s->max_us) / 1000.0, cnt);
+    }
+}
+// ;latency
+
+// :sfx
+// Every effect owns a small pool of sound aliases so it can overlap with itself. Triggers are only recorded while the
+// frame runs and `sfx_flush` plays each triggered effect once, so a burst of identical triggers costs one voice.
+// When MAX_VOICES are busy the oldest voice of a lower (or equal) priority effect is stolen, or the trigger is dropped.
+// The cap is below the pooled voices, otherwise the bank could only be full with every effect saturated.
+#define MAX_SFX 8
+#define SFX_VOICES 4
+#define MAX_VOICES 6
+
+typedef int32_t SfxID;
+
+typedef struct Sfx {
+    SoundID sound;
+    uint32_t sound_rev;
+    int priority;
+    float min_interval;
+    bool has_voices;
+    bool triggered;
+    unsigned long long trigger_us;
+    unsigned long long last_trigger_us;
+    double last_played;
+    Sound voices[SFX_VOICES];
+    double started[SFX_VOICES];
+} Sfx;
+
+typedef struct SfxBank {
+    Sfx sfx[MAX_SFX];
+    int cnt;
+} SfxBank;
+
+static SfxBank sfx_bank = {0};
+
+// Trigger time of each pooled voice until the mixer first reads it. raylib stream processors get no context, so every
+// voice has its own tap that stops its clock, written out for MAX_SFX x SFX_VOICES.
+static atomic_ullong sfx_trigger_us[MAX_SFX][SFX_VOICES];
+
+void sfx_voice_mixed(int sfx, int voice) {
+    unsigned long long trigger_us = atomic_exchange(&sfx_trigger_us[sfx][voice], 0);
+    if (trigger_us) {
+        latency_record(&latency, trigger_us);
+    }
+}
+
+_Static_assert(MAX_SFX == 8 && SFX_VOICES == 4, "one sfx tap per voice");
+#define SFX_TAP(s, v)                                                                                                  \
+    void sfx_tap_##s##_##v(void *buffer, unsigned int frames) {                                                       \
+        (void)buffer;                                                                                                  \
+        (void)frames;                                                                                                  \
+        sfx_voice_mixed(s, v);                                                                                         \
+    }
+#define SFX_TAPS(s) SFX_TAP(s, 0) SFX_TAP(s, 1) SFX_TAP(s, 2) SFX_TAP(s, 3)
+#define SFX_TAP_ROW(s) {sfx_tap_##s##_0, sfx_tap_##s##_1, sfx_tap_##s##_2, sfx_tap_##s##_3},
+SFX_TAPS(0) SFX_TAPS(1) SFX_TAPS(2) SFX_TAPS(3) SFX_TAPS(4) SFX_TAPS(5) SFX_TAPS(6) SFX_TAPS(7)
+
+static const AudioCallback sfx_taps[MAX_SFX][SFX_VOICES] = {
+    SFX_TAP_ROW(0) SFX_TAP_ROW(1) SFX_TAP_ROW(2) SFX_TAP_ROW(3) SFX_TAP_ROW(4) SFX_TAP_ROW(5) SFX_TAP_ROW(6) SFX_TAP_ROW(7)
+};
+
+SfxID sfx_add(SfxBank *bank, SoundID sound, int priority, float min_interval) {
+    SfxID id = bank->cnt++;
+    bank->sfx[id] = (Sfx){
+        .sound = sound,
+        .priority = priority,
+        .min_interval = min_interval,
+        .last_played = -1,
+    };
+    return id;
+}
+
+void sfx_drop_voices(Sfx *fx) {
+    if (!fx->has_voices) {
+        return;
+    }
+    for (int i = 0; i < SFX_VOICES; i++) {
+        StopSound(fx->voices[i]);
+        DetachAudioStreamProcessor(fx->voices[i].stream, sfx_taps[fx - sfx_bank.sfx][i]);
+        UnloadSoundAlias(fx->voices[i]);
+    }
+    fx->has_voices = false;
+}
+
+// Gives every effect's sound back to the registry, its voices go with the last reference.
+void sfx_clear(SfxBank *bank) {
+    for (int i = 0; i < bank->cnt; i++) {
+        sfx_drop_voices(&bank->sfx[i]);
+        asset_release(bank->sfx[i].sound);
+    }
+    bank->cnt = 0;
+}
+
+// Hooked into the registry so aliases never outlive the sample data they share.
+void sfx_on_unload(AssetID id) {
+    for (int i = 0; i < sfx_bank.cnt; i++) {
+        if (sfx_bank.sfx[i].sound == id) {
+            sfx_drop_voices(&sfx_bank.sfx[i]);
+        }
+    }
+}
+
+bool sfx_ensure_voices(Sfx *fx) {
+    Asset *a = &assets.items[fx->sound];
+    if (!a->ready) {
+        return false;
+    }
+    if (fx->has_voices && fx->sound_rev == a->rev) {
+        return true;
+    }
+    sfx_drop_voices(fx);
+    for (int i = 0; i < SFX_VOICES; i++) {
+        fx->voices[i] = LoadSoundAlias(a->snd);
+        AttachAudioStreamProcessor(fx->voices[i].stream, sfx_taps[fx - sfx_bank.sfx][i]);
+        fx->started[i] = 0;
+    }
+    fx->sound_rev = a->rev;
+    fx->has_voices = true;
+    return true;
+}
+
+// Finds the voice to steal when the whole bank is busy among effects that do not outrank `priority`: the lowest
+// priority first, the oldest voice among equals.
+Sound *sfx_steal(SfxBank *bank, int priority) {
+    Sound *victim = NULL;
+    int victim_priority = 0;
+    double oldest = 0;
+    for (int i = 0; i < bank->cnt; i++) {
+        Sfx *fx = &bank->sfx[i];
+        if (!fx->has_voices || fx->priority > priority) {
+            continue;
+        }
+        for (int v = 0; v < SFX_VOICES; v++) {
+            if (!IsSoundPlaying(fx->voices[v])) {
+                continue;
+            }
+            if (!victim || fx->priority < victim_priority || (fx->priority == victim_priority && fx->started[v] < oldest)) {
+                victim = &fx->voices[v];
+                victim_priority = fx->priority;
+                oldest = fx->started[v];
+            }
+        }
+    }
+    return victim;
+}
+
+void sfx_flush(SfxBank *bank) {
+    double now = GetTime();
+    int busy = 0;
+    for (int i = 0; i < bank->cnt; i++) {
+        Sfx *fx = &bank->sfx[i];
+        for (int v = 0; fx->has_voices && v < SFX_VOICES; v++) {
+            busy += IsSoundPlaying(fx->voices[v]);
+        }
+    }
+
+    for (int i = 0; i < bank->cnt; i++) {
+        Sfx *fx = &bank->sfx[i];
+        if (!fx->triggered) {
+            continue;
+        }
+        fx->triggered = false;
+        if (now - fx->last_played < fx->min_interval || !sfx_ensure_voices(fx)) {
+            continue;
+        }
+
+        int voice = -1;
+        for (int v = 0; v < SFX_VOICES; v++) {
+            if (!IsSoundPlaying(fx->voices[v])) {
+                voice = v;
+                break;
+            }
+            if (voice < 0 || fx->started[v] < fx->started[voice]) {
+                voice = v;
+            }
+        }
+        // An effect with all its voices playing recycles its own oldest one, only a free voice makes it take one from
+        // another effect.
+        if (IsSoundPlaying(fx->voices[voice])) {
+            StopSound(fx->voices[voice]);
+        } else if (busy >= MAX_VOICES) {
+            Sound *victim = sfx_steal(bank, fx->priority);
+            if (!victim) {
+                continue;
+            }
+            StopSound(*victim);
+        } else {
+            busy++;
+        }
+        atomic_store(&sfx_trigger_us[i][voice], fx->trigger_us);
+        PlaySound(fx->voices[voice]);
+        fx->started[voice] = now;
+        fx->last_played = now;
+    }
+}
+// ;sfx
+
+// :lowlat
+// Low latency mode skips raylib's per-sound buffers. Triggers go straight into a single producer / single consumer
+// queue and are mixed by a callback stream, which raylib pulls on the device thread whenever it needs samples, so a
+// jump is heard on the next device period instead of after the end of the frame. Samples are kept as float stereo at
+// the stream rate; hot reloading does not reach them.
+#define AUDIO_LOW_LATENCY false
+#define LOWLAT_SAMPLE_RATE 48000
+#define LOWLAT_BUFFER_FRAMES 256
+#define LOWLAT_QUEUE 64
+#define LOWLAT_VOICES 16
+
+typedef struct LowLatCmd {
+    SfxID sfx;
+    unsigned long long trigger_us;
+} LowLatCmd;
+
+typedef struct LowLatVoice {
+    bool active;
+    bool measured;
+    SfxID sfx;
+    uint32_t pos;
+    unsigned long long trigger_us;
+} LowLatVoice;
+
+typedef struct LowLat {
+    bool enabled;
+    bool ready;
+    AudioStream stream;
+    Wave waves[MAX_SFX];
+    int priorities[MAX_SFX];
+    LowLatCmd queue[LOWLAT_QUEUE];
+    atomic_uint head;
+    atomic_uint tail;
+    LowLatVoice voices[LOWLAT_VOICES];
+} LowLat;
+
+static LowLat lowlat = {0};
+
+bool lowlat_push(LowLat *ll, LowLatCmd cmd) {
+    unsigned int head = atomic_load_explicit(&ll->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ll->tail, memory_order_acquire);
+    if (head - tail >= LOWLAT_QUEUE) {
+        return false;
+    }
+    ll->queue[head % LOWLAT_QUEUE] = cmd;
+    atomic_store_explicit(&ll->head, head + 1, memory_order_release);
+    return true;
+}
+
+void lowlat_start_voice(LowLat *ll, LowLatCmd cmd) {
+    LowLatVoice *slot = NULL;
+    for (int i = 0; i < LOWLAT_VOICES; i++) {
+        LowLatVoice *v = &ll->voices[i];
+        if (!v->active) {
+            slot = v;
+            break;
+        }
+        if (ll->priorities[v->sfx] <= ll->priorities[cmd.sfx] && (!slot || v->trigger_us < slot->trigger_us)) {
+            slot = v;
+        }
+    }
+    if (slot) {
+        *slot = (LowLatVoice){true, false, cmd.sfx, 0, cmd.trigger_us};
+    }
+}
+
+// Runs on the audio device thread with raylib's mixer lock held, so it must not call back into raylib audio.
+void lowlat_mix(void *buffer, unsigned int frames) {
+    LowLat *ll = &lowlat;
+    float *out = buffer;
+    memset(out, 0, frames * 2 * sizeof(float));
+
+    unsigned int tail = atomic_load_explicit(&ll->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ll->head, memory_order_acquire);
+    while (tail != head) {
+        lowlat_start_voice(ll, ll->queue[tail % LOWLAT_QUEUE]);
+        tail++;
+    }
+    atomic_store_explicit(&ll->tail, tail, memory_order_release);
+
+    for (int i = 0; i < LOWLAT_VOICES; i++) {
+        LowLatVoice *v = &ll->voices[i];
+        if (!v->active) {
+            continue;
+        }
+        Wave *w = &ll->waves[v->sfx];
+        const float *src = (const float *)w->data + v->pos * 2;
+        uint32_t n = w->frameCount - v->pos < frames ? w->frameCount - v->pos : frames;
+        for (uint32_t f = 0; f < n * 2; f++) {
+            out[f] += src[f];
+        }
+        if (!v->measured) {
+            latency_record(&latency, v->trigger_us);
+            v->measured = true;
+        }
+        v->pos += n;
+        v->active = v->pos < w->frameCount;
+    }
+    for (unsigned int f = 0; f < frames * 2; f++) {
+        out[f] = Clamp(out[f], -1, 1);
+    }
+}
+
+void lowlat_init(LowLat *ll, SfxBank *bank) {
+    if (ll->ready) {
+        return;
+    }
+    bool own_pack = !pack.data && pack_open(&pack, PACK_PATH);
+    for (int i = 0; i < bank->cnt; i++) {
+        const char *path = assets.items[bank->sfx[i].sound].path;
+        Wave wave;
+        if (pack_wave(&pack, path, &wave)) {
+            wave = WaveCopy(wave);
+        } else {
+            wave = LoadWave(path);
+        }
+        if (IsWaveReady(wave)) {
+            WaveFormat(&wave, LOWLAT_SAMPLE_RATE, 32, 2);
+        }
+        ll->waves[i] = wave;
+        ll->priorities[i] = bank->sfx[i].priority;
+    }
+    if (own_pack) {
+        pack_close(&pack);
+    }
+
+    SetAudioStreamBufferSizeDefault(LOWLAT_BUFFER_FRAMES);
+    ll->stream = LoadAudioStream(LOWLAT_SAMPLE_RATE, 32, 2);
+    SetAudioStreamBufferSizeDefault(0);
+    SetAudioStreamCallback(ll->stream, lowlat_mix);
+    PlayAudioStream(ll->stream);
+    ll->ready = true;
+}
+
+void lowlat_set_enabled(LowLat *ll, bool enabled) {
+    if (enabled) {
+        lowlat_init(ll, &sfx_bank);
+    }
+    ll->enabled = enabled;
+    latency_reset(&latency);
+}
+
+void sfx_play(SfxID id) {
+    Sfx *fx = &sfx_bank.sfx[id];
+    unsigned long long now = time_us();
+    if (lowlat.enabled) {
+        if (now - fx->last_trigger_us >= fx->min_interval * 1e6 && IsWaveReady(lowlat.waves[id])) {
+            fx->last_trigger_us = now;
+            lowlat_push(&lowlat, (LowLatCmd){id, now});
+        }
+        return;
+    }
+    if (!fx->triggered) {
+        fx->trigger_us = now;
+    }
+    fx->triggered = true;
+}
+// ;lowlat
+
+// :music
+// Background music is streamed: a decode thread reads PCM from the WAV file into a fixed ring buffer and a callback
+// stream drains it on the audio thread, so memory stays at MUSIC_RING_BYTES whatever the track length and the main
+// loop never touches the file. Without threads the ring is topped up from `music_update` with a per frame budget.
+#define MUSIC_PATH "./assets/music/theme.wav"
+#define MUSIC_RING_BYTES (256 * 1024)
+#define MUSIC_CHUNK_BYTES (16 * 1024)
+#define MUSIC_VOLUME 0.5f
+
+typedef struct MusicStream {
+    FILE *file;
+    long data_start;
+    uint32_t data_size;
+    uint32_t data_pos;
+    int sample_rate;
+    int sample_size;
+    int channels;
+    int frame_bytes;
+    bool looping;
+    bool playing;
+    unsigned char *ring;
+    atomic_uint write;
+    atomic_uint read;
+    atomic_bool running;
+    AudioStream stream;
+#ifdef HAS_THREADS
+    bool threaded;
+    thrd_t thread;
+#endif
+} MusicStream;
+
+static MusicStream music = {0};
+
+uint32_t read_u32le(const unsigned char *p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Only walks the RIFF chunks, the samples are left in the file. Supports 16 bit PCM and 32 bit float.
+bool music_parse_wav(MusicStream *m) {
+    unsigned char hdr[12];
+    if (fread(hdr, 1, 12, m->file) != 12 || memcmp(hdr, "RIFF", 4) != 0 || memcmp(hdr + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    bool has_fmt = false;
+    unsigned char chunk[8];
+    while (fread(chunk, 1, 8, m->file) == 8) {
+        uint32_t size = read_u32le(chunk + 4);
+        if (memcmp(chunk, "fmt ", 4) == 0) {
+            unsigned char fmt[16];
+            if (size < 16 || fread(fmt, 1, 16, m->file) != 16) {
+                return false;
+            }
+            int format = fmt[0] | (fmt[1] << 8);
+            m->channels = fmt[2] | (fmt[3] << 8);
+            m->sample_rate = read_u32le(fmt + 4);
+            m->sample_size = fmt[14] | (fmt[15] << 8);
+            if (!((format == 1 && m->sample_size == 16) || (format == 3 && m->sample_size == 32)) || m->channels < 1 || m->channels > 2) {
+                return false;
+            }
+            m->frame_bytes = m->channels * m->sample_size / 8;
+            has_fmt = true;
+            fseek(m->file, size - 16 + (size & 1), SEEK_CUR);
+        } else if (memcmp(chunk, "data", 4) == 0) {
+            m->data_start = ftell(m->file);
+            m->data_size = size - size % (m->frame_bytes ? m->frame_bytes : 1);
+            m->data_pos = 0;
+            return has_fmt;
+        } else {
+            fseek(m->file, size + (size & 1), SEEK_CUR);
+        }
+    }
+    return false;
+}
+
+// Producer side of the ring, reads at most `budget` bytes. Returns how many bytes were added.
+uint32_t music_fill(MusicStream *m, uint32_t budget) {
+    uint32_t w = atomic_load_explicit(&m->write, memory_order_relaxed);
+    uint32_t r = atomic_load_explicit(&m->read, memory_order_acquire);
+    uint32_t space = MUSIC_RING_BYTES - (w - r);
+    uint32_t want = space < budget ? space : budget;
+    uint32_t added = 0;
+    while (want > 0) {
+        if (m->data_pos == m->data_size) {
+            if (!m->looping) {
+                break;
+            }
+            fseek(m->file, m->data_start, SEEK_SET);
+            m->data_pos = 0;
+        }
+        uint32_t n = want;
+        if (n > m->data_size - m->data_pos) {
+            n = m->data_size - m->data_pos;
+        }
+        if (n > MUSIC_RING_BYTES - w % MUSIC_RING_BYTES) {
+            n = MUSIC_RING_BYTES - w % MUSIC_RING_BYTES;
+        }
+        size_t got = fread(m->ring + w % MUSIC_RING_BYTES, 1, n, m->file);
+        if (got == 0) {
+            break;
+        }
+        m->data_pos += got;
+        w += got;
+        want -= got;
+        added += got;
+    }
+    atomic_store_explicit(&m->write, w, memory_order_release);
+    return added;
+}
+
+// Consumer side, runs on the audio thread. An underrun plays silence rather than blocking.
+void music_mix(void *buffer, unsigned int frames) {
+    MusicStream *m = &music;
+    unsigned char *out = buffer;
+    uint32_t want = frames * m->frame_bytes;
+    uint32_t r = atomic_load_explicit(&m->read, memory_order_relaxed);
+    uint32_t w = atomic_load_explicit(&m->write, memory_order_acquire);
+    uint32_t n = w - r < want ? w - r : want;
+    uint32_t first = MUSIC_RING_BYTES - r % MUSIC_RING_BYTES;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(out, m->ring + r % MUSIC_RING_BYTES, first);
+    memcpy(out + first, m->ring, n - first);
+    memset(out + n, 0, want - n);
+    atomic_store_explicit(&m->read, r + n, memory_order_release);
+}
+
+#ifdef HAS_THREADS
+int music_decoder(void *arg) {
+    MusicStream *m = arg;
+    while (atomic_load(&m->running)) {
+        if (music_fill(m, MUSIC_CHUNK_BYTES) == 0) {
+            thrd_sleep(&(struct timespec){.tv_nsec = 5 * 1000 * 1000}, NULL);
+        }
+    }
+    return 0;
+}
+#endif
+
+bool music_open(MusicStream *m, const char *path, bool looping) {
+    m->file = fopen(path, "rb");
+    if (!m->file) {
+        return false;
+    }
+    if (!music_parse_wav(m)) {
+        TraceLog(LOG_WARNING, "music: %s is not a 16 bit PCM or float WAV file", path);
+        fclose(m->file);
+        m->file = NULL;
+        return false;
+    }
+    if (!m->ring) {
+        m->ring = arena_alloc(&arena, MUSIC_RING_BYTES);
+    }
+    m->looping = looping;
+    atomic_store(&m->write, 0);
+    atomic_store(&m->read, 0);
+    atomic_store(&m->running, true);
+
+    m->stream = LoadAudioStream(m->sample_rate, m->sample_size, m->channels);
+    SetAudioStreamCallback(m->stream, music_mix);
+    SetAudioStreamVolume(m->stream, MUSIC_VOLUME);
+#ifdef HAS_THREADS
+    m->threaded = thrd_create(&m->thread, music_decoder, m) == thrd_success;
+#endif
+    PlayAudioStream(m->stream);
+    m->playing = true;
+    return true;
+}
+
+void music_update(MusicStream *m) {
+#ifdef HAS_THREADS
+    if (m->threaded) {
+        return;
+    }
+#endif
+    if (m->playing) {
+        music_fill(m, MUSIC_CHUNK_BYTES);
+    }
+}
+
+void music_close(MusicStream *m) {
+    if (!m->playing) {
+        return;
+    }
+    atomic_store(&m->running, false);
+#ifdef HAS_THREADS
+    if (m->threaded) {
+        thrd_join(m->thread, NULL);
+        m->threaded = false;
+    }
+#endif
+    UnloadAudioStream(m->stream);
+    fclose(m->file);
+    m->file = NULL;
+    m->playing = false;
+}
+// ;music
+
+static SfxID sfx_land;
+static SfxID sfx_jump;
+static SfxID sfx_pickup;
+
+// :anim
+// Sprite sheets are described by assets/sprites.txt, one clip per line, and every frame rectangle is computed once
+// when it is loaded. Running animations are stored as parallel arrays and all of them advance in one pass per frame.
+#define SPRITES_PATH "./assets/sprites.txt"
+#define MAX_CLIPS 32
+#define MAX_CLIP_FRAMES 512
+#define MAX_ANIMS 1024
+
+typedef int32_t ClipID;
+typedef int32_t AnimID;
+
+typedef struct SpriteClip {
+    char name[32];
+    TextureID tex;
+    int32_t first_frame;
+    int32_t frame_cnt;
+    float frame_time;
+} SpriteClip;
+
+typedef struct Sprites {
+    SpriteClip clips[MAX_CLIPS];
+    int32_t clip_cnt;
+    Rectangle frames[MAX_CLIP_FRAMES];
+    int32_t frame_cnt;
+} Sprites;
+
+// Slot 0 is never handed out so a zeroed Entity has no animation.
+typedef struct Animator {
+    ClipID clip[MAX_ANIMS];
+    int32_t first_frame[MAX_ANIMS];
+    int32_t frame_cnt[MAX_ANIMS];
+    int32_t frame[MAX_ANIMS];
+    float timer[MAX_ANIMS];
+    float speed[MAX_ANIMS];
+    int32_t cnt;
+} Animator;
+
+static Sprites sprites = {0};
+static Animator animator = {.cnt = 1};
+
+// Line format: name texture x y width height stride frames seconds_per_frame, lines starting with '#' are skipped.
+// Frame i of a clip is the width x height rectangle at (x + i * stride, y).
+bool sprites_load(Sprites *s, const char *path) {
+    char *text = LoadFileText(path);
+    if (!text) {
+        TraceLog(LOG_WARNING, "sprites: could not read %s", path);
+        return false;
+    }
+    for (char *line = text; line && *line;) {
+        char *next = strchr(line, '\n');
+        if (next) {
+            *next++ = 0;
+        }
+        char name[32], tex[PACK_PATH_LEN];
+        float x, y, w, h, stride, frame_time;
+        int frames;
+        if (line[0] != '#' &&
+            sscanf(line, "%31s %63s %f %f %f %f %f %d %f", name, tex, &x, &y, &w, &h, &stride, &frames, &frame_time) == 9) {
+            if (frames <= 0 || s->clip_cnt == MAX_CLIPS || s->frame_cnt + frames > MAX_CLIP_FRAMES) {
+                TraceLog(LOG_WARNING, "sprites: dropping clip %s", name);
+            } else {
+                SpriteClip *c = &s->clips[s->clip_cnt++];
+                strcpy(c->name, name);
+                c->tex = tex_acquire(tex);
+                c->first_frame = s->frame_cnt;
+                c->frame_cnt = frames;
+                c->frame_time = frame_time;
+                for (int i = 0; i < frames; i++) {
+                    s->frames[s->frame_cnt++] = (Rectangle){x + i * stride, y, w, h};
+                }
+            }
+        }
+        line = next;
+    }
+    UnloadFileText(text);
+    return true;
+}
+
+void sprites_unload(Sprites *s) {
+    for (ClipID i = 0; i < s->clip_cnt; i++) {
+        asset_release(s->clips[i].tex);
+    }
+    s->clip_cnt = 0;
+    s->frame_cnt = 0;
+}
+
+ClipID sprites_find(Sprites *s, const char *name) {
+    for (ClipID i = 0; i < s->clip_cnt; i++) {
+        if (strcmp(s->clips[i].name, name) == 0) {
+            return i;
+        }
+    }
+    TraceLog(LOG_WARNING, "sprites: unknown clip %s", name);
+    return -1;
+}
+
+void anim_play(Animator *a, AnimID id, ClipID clip) {
+    SpriteClip *c = clip >= 0 ? &sprites.clips[clip] : &(SpriteClip){.frame_cnt = 1, .frame_time = INFINITY};
+    a->clip[id] = clip;
+    a->first_frame[id] = c->first_frame;
+    a->frame_cnt[id] = c->frame_cnt;
+    a->frame[id] = 0;
+    a->timer[id] = 0;
+    a->speed[id] = c->frame_time;
+}
+
+AnimID anim_add(Animator *a, ClipID clip) {
+    if (a->cnt == MAX_ANIMS) {
+        return 0;
+    }
+    AnimID id = a->cnt++;
+    anim_play(a, id, clip);
+    return id;
+}
+
+// Branch free so the compiler can vectorize it, the cost is the same for one animation or a thousand.
+void anim_update(Animator *a, float dt) {
+    for (int32_t i = 0; i < a->cnt; i++) {
+        float t = a->timer[i] + dt;
+        int32_t step = t > a->speed[i];
+        int32_t frame = a->frame[i] + step;
+        a->timer[i] = step ? 0 : t;
+        a->frame[i] = frame >= a->frame_cnt[i] ? 0 : frame;
+    }
+}
+
+Rectangle anim_frame(Animator *a, AnimID id, bool flip) {
+    if (a->clip[id] < 0) {
+        return (Rectangle){0};
+    }
+    Rectangle src = sprites.frames[a->first_frame[id] + a->frame[id]];
+    if (flip) {
+        src.width = -src.width;
+    }
+    return src;
+}
+
+TextureID anim_tex(Animator *a, AnimID id) {
+    return a->clip[id] >= 0 ? sprites.clips[a->clip[id]].tex : 0;
+}
+// ;anim
+
+// :timers
+// Gameplay timers live in a hierarchical timing wheel: TIMER_LEVELS wheels of TIMER_SLOTS slots where one slot of a
+// level spans a whole turn of the level below. Scheduling and cancelling are O(1) list operations, a tick only fires
+// one slot and, once per turn, spreads the next slot of the level above over the level below. The wheel only advances
+// while the game runs, so its timers pause with it.
+#define TIMER_HZ 60
+#define TIMER_SLOT_BITS 6
+#define TIMER_SLOTS (1 << TIMER_SLOT_BITS)
+#define TIMER_LEVELS 3
+#define MAX_TIMERS 4096
+
+typedef void (*TimerFn)(void *arg);
+
+// Slot index in the low 16 bits, generation above, 0 is no timer.
+typedef uint32_t TimerID;
+
+// Links and `slot` are stored plus one so a zeroed wheel is empty.
+typedef struct Timer {
+    uint64_t due;
+    TimerFn fn;
+    void *arg;
+    int32_t next;
+    int32_t prev;
+    int32_t slot;
+    uint16_t gen;
+} Timer;
+
+typedef struct TimerWheel {
+    Timer timers[MAX_TIMERS];
+    int32_t heads[TIMER_LEVELS * TIMER_SLOTS];
+    int32_t used;
+    int32_t free;
+    uint64_t tick;
+    float acc;
+} TimerWheel;
+
+static TimerWheel timers = {0};
+
+Timer *timer_get(TimerWheel *w, TimerID id) {
+    int32_t idx = (int32_t)(id & 0xffff) - 1;
+    if (idx < 0 || idx >= w->used || w->timers[idx].gen != (id >> 16) || !w->timers[idx].slot) {
+        return NULL;
+    }
+    return &w->timers[idx];
+}
+
+void timer_link(TimerWheel *w, int32_t idx) {
+    Timer *t = &w->timers[idx];
+    uint64_t delta = t->due - w->tick;
+    int level = 0;
+    while (level < TIMER_LEVELS - 1 && delta >= (1ull << (TIMER_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    // Anything past the last level waits in its furthest slot and is placed again when that slot cascades.
+    uint64_t max_delta = (1ull << (TIMER_SLOT_BITS * TIMER_LEVELS)) - 1;
+    uint64_t at = delta > max_delta ? w->tick + max_delta : t->due;
+    int32_t slot = level * TIMER_SLOTS + (int32_t)((at >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1));
+    t->slot = slot + 1;
+    t->prev = 0;
+    t->next = w->heads[slot];
+    if (t->next) {
+        w->timers[t->next - 1].prev = idx + 1;
+    }
+    w->heads[slot] = idx + 1;
+}
+
+void timer_unlink(TimerWheel *w, int32_t idx) {
+    Timer *t = &w->timers[idx];
+    if (t->prev) {
+        w->timers[t->prev - 1].next = t->next;
+    } else {
+        w->heads[t->slot - 1] = t->next;
+    }
+    if (t->next) {
+        w->timers[t->next - 1].prev = t->prev;
+    }
+    t->slot = 0;
+}
+
+void timer_release(TimerWheel *w, int32_t idx) {
+    w->timers[idx].gen++;
+    w->timers[idx].next = w->free;
+    w->free = idx + 1;
+}
+
+// Calls `fn(arg)` after `seconds` of game time, at least one tick from now.
+TimerID timer_after(TimerWheel *w, float seconds, TimerFn fn, void *arg) {
+    int32_t idx;
+    if (w->free) {
+        idx = w->free - 1;
+        w->free = w->timers[idx].next;
+    } else if (w->used < MAX_TIMERS) {
+        idx = w->used++;
+    } else {
+        TraceLog(LOG_WARNING, "timers: more than %d timers", MAX_TIMERS);
+        return 0;
+    }
+    Timer *t = &w->timers[idx];
+    uint64_t ticks = (uint64_t)fmaxf(roundf(seconds * TIMER_HZ), 1);
+    t->due = w->tick + ticks;
+    t->fn = fn;
+    t->arg = arg;
+    timer_link(w, idx);
+    return ((TimerID)t->gen << 16) | (TimerID)(idx + 1);
+}
+
+void timer_cancel(TimerWheel *w, TimerID id) {
+    Timer *t = timer_get(w, id);
+    if (t) {
+        int32_t idx = t - w->timers;
+        timer_unlink(w, idx);
+        timer_release(w, idx);
+    }
+}
+
+// Seconds until the timer fires, 0 when it already did or was cancelled.
+float timer_left(TimerWheel *w, TimerID id) {
+    Timer *t = timer_get(w, id);
+    return t ? (t->due - w->tick) / (float)TIMER_HZ - w->acc : 0;
+}
+
+// Game time in seconds.
+double timers_now(TimerWheel *w) {
+    return (double)w->tick / TIMER_HZ + w->acc;
+}
+
+void timers_cascade(TimerWheel *w, int level) {
+    int32_t slot = level * TIMER_SLOTS + (int32_t)((w->tick >> (TIMER_SLOT_BITS * level)) & (TIMER_SLOTS - 1));
+    int32_t i = w->heads[slot];
+    w->heads[slot] = 0;
+    while (i) {
+        int32_t next = w->timers[i - 1].next;
+        timer_link(w, i - 1);
+        i = next;
+    }
+}
+
+void timers_tick(TimerWheel *w) {
+    w->tick++;
+    for (int level = TIMER_LEVELS - 1; level > 0; level--) {
+        if ((w->tick & ((1ull << (TIMER_SLOT_BITS * level)) - 1)) == 0) {
+            timers_cascade(w, level);
+        }
+    }
+    int32_t slot = (int32_t)(w->tick & (TIMER_SLOTS - 1));
+    for (int32_t i = w->heads[slot]; i; i = w->heads[slot]) {
+        Timer *t = &w->timers[i - 1];
+        timer_unlink(w, i - 1);
+        timer_release(w, i - 1);
+        t->fn(t->arg);
+    }
+}
+
+void timers_advance(TimerWheel *w, float dt) {
+    w->acc += dt;
+    while (w->acc >= 1.0f / TIMER_HZ) {
+        w->acc -= 1.0f / TIMER_HZ;
+        timers_tick(w);
+    }
+}
+// ;timers
+
+// :particles
+// Fixed pool stored as parallel arrays. The integration loop only touches floats and is written so the compiler can
+// vectorize it, dead particles are compacted afterwards and everything is drawn as quads in a single batch.
+#define MAX_PARTICLES (1 << 15)
+#define PARTICLE_GRAVITY 400.0f
+#define PARTICLE_DRAG 2.0f
+#define PARTICLE_SIZE 3.0f
+
+typedef struct Particles {
+    alignas(32) float x[MAX_PARTICLES];
+    alignas(32) float y[MAX_PARTICLES];
+    alignas(32) float vx[MAX_PARTICLES];
+    alignas(32) float vy[MAX_PARTICLES];
+    alignas(32) float life[MAX_PARTICLES];
+    alignas(32) float inv_life[MAX_PARTICLES];
+    Color color[MAX_PARTICLES];
+    int32_t cnt;
+    uint32_t seed;
+} Particles;
+
+typedef struct Burst {
+    int cnt;
+    float speed;
+    float angle;
+    float spread;
+    float life;
+    Color color;
+} Burst;
+
+static Particles particles = {.seed = 0x9e3779b9};
+
+static const Burst burst_jump = {16, 70, PI / 2, PI / 3, 0.35f, {230, 230, 230, 255}};
+static const Burst burst_land = {24, 60, -PI / 2, PI * 0.9f, 0.4f, {200, 180, 150, 255}};
+static const Burst burst_pickup = {48, 90, 0, PI, 0.6f, {255, 210, 120, 255}};
+
+float particle_rand(Particles *p) {
+    p->seed ^= p->seed << 13;
+    p->seed ^= p->seed >> 17;
+    p->seed ^= p->seed << 5;
+    return (p->seed >> 8) * (1.0f / (1 << 24));
+}
+
+// Angles are in radians with y pointing down, `spread` is the half angle of the cone.
+void particles_burst(Particles *p, Vector2 pos, Burst burst) {
+    int cnt = burst.cnt;
+    if (p->cnt + cnt > MAX_PARTICLES) {
+        cnt = MAX_PARTICLES - p->cnt;
+    }
+    for (int i = 0; i < cnt; i++) {
+        int32_t n = p->cnt++;
+        float angle = burst.angle + (particle_rand(p) * 2 - 1) * burst.spread;
+        float speed = burst.speed * (0.5f + particle_rand(p));
+        float life = burst.life * (0.5f + particle_rand(p));
+        p->x[n] = pos.x;
+        p->y[n] = pos.y;
+        p->vx[n] = cosf(angle) * speed;
+        p->vy[n] = sinf(angle) * speed;
+        p->life[n] = life;
+        p->inv_life[n] = 1 / life;
+        p->color[n] = burst.color;
+    }
+}
+
+void particles_update(Particles *p, float dt) {
+    int32_t n = p->cnt;
+    float *restrict x = p->x;
+    float *restrict y = p->y;
+    float *restrict vx = p->vx;
+    float *restrict vy = p->vy;
+    float *restrict life = p->life;
+    float drag = 1 - PARTICLE_DRAG * dt;
+    float gravity = PARTICLE_GRAVITY * dt;
+    for (int32_t i = 0; i < n; i++) {
+        vx[i] *= drag;
+        vy[i] = vy[i] * drag + gravity;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        life[i] -= dt;
+    }
+
+    int32_t alive = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (life[i] <= 0) {
+            continue;
+        }
+        if (alive != i) {
+            x[alive] = x[i];
+            y[alive] = y[i];
+            vx[alive] = vx[i];
+            vy[alive] = vy[i];
+            life[alive] = life[i];
+            p->inv_life[alive] = p->inv_life[i];
+            p->color[alive] = p->color[i];
+        }
+        alive++;
+    }
+    p->cnt = alive;
+}
+
+// Must be called inside BeginMode2D, rlgl splits the batch by itself when it fills up.
+void particles_draw(Particles *p, Rectangle visible) {
+    rlSetTexture(rlGetTextureIdDefault());
+    rlBegin(RL_QUADS);
+    for (int32_t i = 0; i < p->cnt; i++) {
+        float t = p->life[i] * p->inv_life[i];
+        float h = PARTICLE_SIZE * (0.5f + 0.5f * t) * 0.5f;
+        float x = p->x[i], y = p->y[i];
+        if (x + h < visible.x || x - h > visible.x + visible.width || y + h < visible.y ||
+            y - h > visible.y + visible.height) {
+            continue;
+        }
+        Color c = p->color[i];
+        rlColor4ub(c.r, c.g, c.b, c.a * t);
+        rlTexCoord2f(0, 0);
+        rlVertex2f(x - h, y - h);
+        rlTexCoord2f(0, 1);
+        rlVertex2f(x - h, y + h);
+        rlTexCoord2f(1, 1);
+        rlVertex2f(x + h, y + h);
+        rlTexCoord2f(1, 0);
+        rlVertex2f(x + h, y - h);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+// ;particles
+
+// :en
+typedef enum EntityProp {
+    EP_NIL,
+    EP_COLLIDABLE,
+    EP_RIDABLE,
+    EP_PLAT,
+    EP_TRIGGER,
+} EntityProp;
+
+// Every kind of entity with the batch functions that handle it: emit draw commands, draw on the minimap, react to the
+// player entering it as a trigger and update once per frame. The order is the draw order. See `archetypes`.
+// clang-format off
+#define ARCHETYPES(X)                                                                     \
+    X(EID_NIL,          NULL,             NULL,                NULL,              NULL)   \
+    X(EID_CHUNK,        NULL,             NULL,                NULL,              NULL)   \
+    X(EID_DEAD_ZONE,    dead_zones_emit,  NULL,                enter_dead_zone,   NULL)   \
+    X(EID_MOVING_PLAT,  plats_emit,       plats_minimap,       NULL,              movers_update) \
+    X(EID_PLAT,         plats_emit,       plats_minimap,       NULL,              NULL)   \
+    X(EID_JUMP_COFFEE,  sprites_emit,     pickups_minimap,     enter_pickup,      NULL)   \
+    X(EID_CHECK_COFFEE, checkpoints_emit, checkpoints_minimap, enter_pickup,      NULL)   \
+    X(EID_PLAYER,       NULL,             NULL,                NULL,              NULL)   \
+    X(EID_TROPHY,       sprites_emit,     NULL,                enter_trophy,      trophies_update) \
+    X(EID_WALKER,       animated_emit,    NULL,                NULL,              walkers_think) \
+    // :id
+// clang-format on
+
+typedef enum EntityId {
+#define ARCH_ID(id, emit, minimap, enter, update) id,
+    ARCHETYPES(ARCH_ID)
+#undef ARCH_ID
+    EID_CNT,
+} EntityId;
+
+#define MAX_PROPS 10
+typedef struct Entity {
+    Vector2 pos;
+    Vector2 vel;
+    Vector2 remainder;
+    Vector2 size;
+    Rectangle aabb;
+    bool flip;
+    struct Entity *last_collided;
+    bool is_collidable;
+    int32_t prop_cnt;
+    EntityProp *props;
+    bool grounded;
+    EntityId id;
+    Vector2 respawn;
+    TextureID texId;
+    AnimID anim;
+    bool is_valid;
+    bool played_land;
+    void *user_data;
+    bool in_broad;
+    bool broad_solid;
+    int32_t broad_lo;
+    int32_t broad_hi;
+    struct Entity *riding;
+    Vector2 moved;
+    struct ContactCache *contacts;
+    int32_t actor;
+} Entity;
+
+void en_setup(Entity *en, float x, float y, float w, float h) {
+    en->vel = (Vector2){0, 0};
+    en->remainder = (Vector2){0, 0};
+    en->pos = (Vector2){x, y};
+    en->size = (Vector2){w, h};
+    en->aabb = (Rectangle){x, y, w, h};
+    en->is_valid = true;
+    en->played_land = true;
+    en->actor = -1;
+    en->props = arena_alloc(&arena, sizeof(EntityProp) * MAX_PROPS);
+    memset(en->props, 0, sizeof(EntityProp) * MAX_PROPS);
+}
+
+void en_add_props(Entity *en, EntityProp prop) {
+    en->props[en->prop_cnt++] = prop;
+}
+
+bool en_has_prop(Entity *en, EntityProp prop) {
+    if (en->prop_cnt <= 0)
+        return false;
+    for (int i = 0; i < MAX_PROPS; i++) {
+        if (en->props[i] == prop)
+            return true;
+    }
+    return false;
+}
+
+// :aabb
+// Boxes are stored as separate min / max arrays so a single compare tests AABB_LANES candidates against one moving
+// box. The tests use the same strict inequalities as CheckCollisionRecs, so touching edges never count as a hit.
+// Build with -mavx for 8 lanes, x86-64 always has SSE2 for 4, anything else gets the scalar loop.
+#if defined(__AVX__)
+#include <immintrin.h>
+#define AABB_LANES 8
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define AABB_LANES 4
+#else
+#define AABB_LANES 1
+#endif
+#define AABB_SET_CAP 64
+
+typedef struct AabbSet {
+    alignas(32) float min_x[AABB_SET_CAP];
+    alignas(32) float min_y[AABB_SET_CAP];
+    alignas(32) float max_x[AABB_SET_CAP];
+    alignas(32) float max_y[AABB_SET_CAP];
+    int32_t cnt;
+} AabbSet;
+
+bool aabb_set_push(AabbSet *s, Rectangle r) {
+    if (s->cnt == AABB_SET_CAP) {
+        return false;
+    }
+    int32_t i = s->cnt++;
+    s->min_x[i] = r.x;
+    s->min_y[i] = r.y;
+    s->max_x[i] = r.x + r.width;
+    s->max_y[i] = r.y + r.height;
+    return true;
+}
+
+int32_t aabb_first_hit_scalar(const AabbSet *s, int32_t start, Rectangle box) {
+    float x0 = box.x, y0 = box.y, x1 = box.x + box.width, y1 = box.y + box.height;
+    for (int32_t i = start; i < s->cnt; i++) {
+        if (s->min_x[i] < x1 && s->max_x[i] > x0 && s->min_y[i] < y1 && s->max_y[i] > y0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Index of the first box at or after `start` that overlaps `box`, -1 if there is none. Whole lanes are loaded, lanes
+// before `start` or past `cnt` are masked out of the result.
+int32_t aabb_first_hit(const AabbSet *s, int32_t start, Rectangle box) {
+#if AABB_LANES == 1
+    return aabb_first_hit_scalar(s, start, box);
+#else
+    float x0 = box.x, y0 = box.y, x1 = box.x + box.width, y1 = box.y + box.height;
+#if AABB_LANES == 8
+    __m256 vx0 = _mm256_set1_ps(x0), vy0 = _mm256_set1_ps(y0), vx1 = _mm256_set1_ps(x1), vy1 = _mm256_set1_ps(y1);
+#else
+    __m128 vx0 = _mm_set1_ps(x0), vy0 = _mm_set1_ps(y0), vx1 = _mm_set1_ps(x1), vy1 = _mm_set1_ps(y1);
+#endif
+    for (int32_t i = start & ~(AABB_LANES - 1); i < s->cnt; i += AABB_LANES) {
+#if AABB_LANES == 8
+        __m256 x = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(s->min_x + i), vx1, _CMP_LT_OQ),
+                                 _mm256_cmp_ps(_mm256_load_ps(s->max_x + i), vx0, _CMP_GT_OQ));
+        __m256 y = _mm256_and_ps(_mm256_cmp_ps(_mm256_load_ps(s->min_y + i), vy1, _CMP_LT_OQ),
+                                 _mm256_cmp_ps(_mm256_load_ps(s->max_y + i), vy0, _CMP_GT_OQ));
+        unsigned mask = _mm256_movemask_ps(_mm256_and_ps(x, y));
+#else
+        __m128 x = _mm_and_ps(_mm_cmplt_ps(_mm_load_ps(s->min_x + i), vx1), _mm_cmpgt_ps(_mm_load_ps(s->max_x + i), vx0));
+        __m128 y = _mm_and_ps(_mm_cmplt_ps(_mm_load_ps(s->min_y + i), vy1), _mm_cmpgt_ps(_mm_load_ps(s->max_y + i), vy0));
+        unsigned mask = _mm_movemask_ps(_mm_and_ps(x, y));
+#endif
+        if (i < start) {
+            mask &= ~0u << (start - i);
+        }
+        if (s->cnt - i < AABB_LANES) {
+            mask &= (1u << (s->cnt - i)) - 1;
+        }
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    return -1;
+#endif
+}
+// ;aabb
+
+// :tiles
+// Static platforms sit on a 16px grid, so the collision side of the level is an occupancy bitset per tile row: bit i of
+// a row is column TILE_MIN_COL + i. Rows are grouped in chunks of TILE_CHUNK_ROWS allocated as the level grows up or
+// down, each chunk also keeps the platforms starting in it so they can still be drawn. A platform costs a StaticPlat
+// plus its bits instead of a full Entity. Platforms store their row within the chunk, so moving the world origin only
+// moves `chunk_lo`.
+#define TILE_SIZE 16
+#define TILE_CHUNK_ROWS 64
+#define TILE_MIN_COL -32
+
+typedef enum PlatType {
+    PT_ONE_WIDE,
+    PT_TWO_WIDE,
+    PT_THREE_WIDE,
+    PT_FINAL = 5,
+} PlatType;
+
+typedef struct StaticPlat {
+    int16_t col;
+    uint8_t row;
+    uint8_t type;
+    bool removed;
+} StaticPlat;
+
+typedef struct TileChunk {
+    uint64_t rows[TILE_CHUNK_ROWS];
+    StaticPlat *plats;
+    int32_t plat_cnt;
+    int32_t plat_cap;
+} TileChunk;
+
+typedef struct Tilemap {
+    TileChunk *chunks;
+    int32_t chunk_lo;
+    int32_t chunk_cnt;
+    bool cut;
+    float cut_y;
+    TextureID tex;
+} Tilemap;
+
+int32_t tile_of(float v) {
+    return (int32_t)floorf(v / TILE_SIZE);
+}
+
+int32_t tile_chunk_of(int32_t row) {
+    return row >= 0 ? row / TILE_CHUNK_ROWS : (row + 1) / TILE_CHUNK_ROWS - 1;
+}
+
+// Size in tiles, the plat type is its width minus one except for the final block.
+int32_t plat_tiles_w(PlatType type) {
+    return type + 1;
+}
+
+int32_t plat_tiles_h(PlatType type) {
+    return type == PT_FINAL ? 3 : 1;
+}
+
+Rectangle static_plat_rect(int32_t chunk, const StaticPlat *p) {
+    float y = (chunk * TILE_CHUNK_ROWS + p->row) * TILE_SIZE;
+    return (Rectangle){p->col * TILE_SIZE, y, plat_tiles_w(p->type) * TILE_SIZE, plat_tiles_h(p->type) * TILE_SIZE};
+}
+
+// Bits for columns c0..c1, columns outside the map are dropped.
+uint64_t tile_mask(int32_t c0, int32_t c1) {
+    c0 -= TILE_MIN_COL;
+    c1 -= TILE_MIN_COL;
+    c0 = c0 < 0 ? 0 : c0;
+    c1 = c1 > 63 ? 63 : c1;
+    if (c0 > c1) {
+        return 0;
+    }
+    return (~0ull >> (63 - (c1 - c0))) << c0;
+}
+
+TileChunk *tilemap_chunk(Tilemap *t, int32_t chunk, bool create) {
+    if (chunk >= t->chunk_lo && chunk < t->chunk_lo + t->chunk_cnt) {
+        return &t->chunks[chunk - t->chunk_lo];
+    }
+    if (!create) {
+        return NULL;
+    }
+    int32_t lo = t->chunk_cnt && t->chunk_lo < chunk ? t->chunk_lo : chunk;
+    int32_t hi = t->chunk_cnt && t->chunk_lo + t->chunk_cnt - 1 > chunk ? t->chunk_lo + t->chunk_cnt - 1 : chunk;
+    // Grown by at least its size towards the new chunk, so streaming an endless tower in stays linear.
+    if (t->chunk_cnt && chunk < t->chunk_lo && lo > t->chunk_lo - t->chunk_cnt) {
+        lo = t->chunk_lo - t->chunk_cnt;
+    } else if (t->chunk_cnt && chunk > t->chunk_lo && hi < t->chunk_lo + 2 * t->chunk_cnt - 1) {
+        hi = t->chunk_lo + 2 * t->chunk_cnt - 1;
+    }
+    TileChunk *chunks = arena_alloc(&arena, (hi - lo + 1) * sizeof(TileChunk));
+    memset(chunks, 0, (hi - lo + 1) * sizeof(TileChunk));
+    if (t->chunk_cnt) {
+        memcpy(chunks + (t->chunk_lo - lo), t->chunks, t->chunk_cnt * sizeof(TileChunk));
+    }
+    t->chunks = chunks;
+    t->chunk_lo = lo;
+    t->chunk_cnt = hi - lo + 1;
+    return &t->chunks[chunk - lo];
+}
+
+uint64_t tilemap_row(Tilemap *t, int32_t row) {
+    TileChunk *c = tilemap_chunk(t, tile_chunk_of(row), false);
+    return c ? c->rows[row - tile_chunk_of(row) * TILE_CHUNK_ROWS] : 0;
+}
+
+void tilemap_set(Tilemap *t, int32_t chunk, const StaticPlat *p) {
+    uint64_t mask = tile_mask(p->col, p->col + plat_tiles_w(p->type) - 1);
+    int32_t first = chunk * TILE_CHUNK_ROWS + p->row;
+    for (int32_t row = first; row < first + plat_tiles_h(p->type); row++) {
+        int32_t chunk = tile_chunk_of(row);
+        tilemap_chunk(t, chunk, true)->rows[row - chunk * TILE_CHUNK_ROWS] |= mask;
+    }
+}
+
+// Returns false and adds nothing when the platform is off the grid or has columns outside the map.
+bool tilemap_add(Tilemap *t, float x, float y, PlatType type) {
+    int32_t row = tile_of(y);
+    int32_t chunk = tile_chunk_of(row);
+    StaticPlat p = {tile_of(x), row - chunk * TILE_CHUNK_ROWS, type, false};
+    uint64_t mask = tile_mask(p.col, p.col + plat_tiles_w(type) - 1);
+    if (x != p.col * TILE_SIZE || y != row * TILE_SIZE || __builtin_popcountll(mask) != plat_tiles_w(type)) {
+        return false;
+    }
+    tilemap_set(t, chunk, &p);
+    TileChunk *c = tilemap_chunk(t, chunk, true);
+    if (c->plat_cnt == c->plat_cap) {
+        int32_t new_cap = c->plat_cap ? c->plat_cap * 2 : 16;
+        c->plats = arena_realloc(&arena, c->plats, c->plat_cap * sizeof(StaticPlat), new_cap * sizeof(StaticPlat));
+        c->plat_cap = new_cap;
+    }
+    c->plats[c->plat_cnt++] = p;
+    return true;
+}
+
+// Same strict overlap as CheckCollisionRecs: a box resting on a tile does not hit it.
+bool tilemap_solid(Tilemap *t, Rectangle r) {
+    if (r.width <= 0 || r.height <= 0) {
+        return false;
+    }
+    uint64_t mask = tile_mask(tile_of(r.x), (int32_t)ceilf((r.x + r.width) / TILE_SIZE) - 1);
+    if (!mask) {
+        return false;
+    }
+    int32_t r1 = (int32_t)ceilf((r.y + r.height) / TILE_SIZE) - 1;
+    for (int32_t row = tile_of(r.y); row <= r1; row++) {
+        if (tilemap_row(t, row) & mask) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Drops every platform below `y` for good, like invalidating entities under the dead zone. Returns true when something
+// was removed.
+bool tilemap_cut(Tilemap *t, float y) {
+    if (t->cut && y >= t->cut_y) {
+        return false;
+    }
+    t->cut = true;
+    t->cut_y = y;
+    int32_t first = tile_chunk_of(tile_of(y));
+    first = first < t->chunk_lo ? t->chunk_lo : first;
+    int32_t end = t->chunk_lo + t->chunk_cnt;
+    bool removed = false;
+    for (int32_t k = first; k < end; k++) {
+        TileChunk *c = &t->chunks[k - t->chunk_lo];
+        for (int32_t i = 0; i < c->plat_cnt; i++) {
+            if (!c->plats[i].removed && static_plat_rect(k, &c->plats[i]).y > y) {
+                c->plats[i].removed = true;
+                removed = true;
+            }
+        }
+    }
+    if (!removed) {
+        return false;
+    }
+    // Platforms may overlap, so the rows are rebuilt from what is left instead of clearing bits per platform.
+    for (int32_t k = first; k < end; k++) {
+        memset(t->chunks[k - t->chunk_lo].rows, 0, sizeof(t->chunks[0].rows));
+    }
+    for (int32_t k = first - 1; k < end; k++) {
+        TileChunk *c = tilemap_chunk(t, k, false);
+        for (int32_t i = 0; c && i < c->plat_cnt; i++) {
+            if (!c->plats[i].removed) {
+                tilemap_set(t, k, &c->plats[i]);
+            }
+        }
+    }
+    return true;
+}
+
+// `dy` is a whole number of chunks, see world_rebase.
+void tilemap_rebase(Tilemap *t, float dy) {
+    t->chunk_lo -= (int32_t)dy / (TILE_CHUNK_ROWS * TILE_SIZE);
+    t->cut_y -= dy;
+}
+// ;tiles
+
+// :broad
+// Entities are bucketed by the 64px rows they cover, rows are hashed into a fixed table so the tower height does not
+// matter. Moving an entity only touches the buckets when its row span changes. Collidable entities are kept at the
+// front of every bucket, so collision queries never walk past the NPCs and pickups sharing the row. `rev` of a bucket
+// changes whenever a collidable entity in it is added, removed or moved.
+#define BROAD_ROW 64
+#define BROAD_BUCKETS 256
+#define BROAD_MAX_HITS 64
+
+typedef struct BroadBucket {
+    Entity **items;
+    int32_t cnt;
+    int32_t solid_cnt;
+    int32_t cap;
+    uint32_t rev;
+} BroadBucket;
+
+// Static platforms are not in the buckets, they only exist in `tiles`.
+typedef struct Broadphase {
+    BroadBucket buckets[BROAD_BUCKETS];
+    Tilemap tiles;
+} Broadphase;
+
+int32_t broad_row(float y) {
+    return (int32_t)floorf(y / BROAD_ROW);
+}
+
+BroadBucket *broad_bucket(Broadphase *bp, int32_t row) {
+    return &bp->buckets[(uint32_t)row & (BROAD_BUCKETS - 1)];
+}
+
+// Every prop that can only be found on collidable entities.
+bool broad_solid_prop(EntityProp prop) {
+    return prop == EP_COLLIDABLE || prop == EP_RIDABLE || prop == EP_PLAT;
+}
+
+void broad_insert(Broadphase *bp, Entity *e) {
+    e->broad_lo = broad_row(e->aabb.y);
+    e->broad_hi = broad_row(e->aabb.y + e->aabb.height);
+    e->in_broad = true;
+    e->broad_solid = en_has_prop(e, EP_COLLIDABLE);
+    for (int32_t row = e->broad_lo; row <= e->broad_hi; row++) {
+        BroadBucket *b = broad_bucket(bp, row);
+        if (b->cnt == b->cap) {
+            int32_t new_cap = b->cap ? b->cap * 2 : 16;
+            b->items = arena_realloc(&arena, b->items, b->cap * sizeof(Entity *), new_cap * sizeof(Entity *));
+            b->cap = new_cap;
+        }
+        if (e->broad_solid) {
+            b->items[b->cnt++] = b->items[b->solid_cnt];
+            b->items[b->solid_cnt++] = e;
+            b->rev++;
+        } else {
+            b->items[b->cnt++] = e;
+        }
+    }
+}
+
+void broad_remove(Broadphase *bp, Entity *e) {
+    if (!e->in_broad) {
+        return;
+    }
+    for (int32_t row = e->broad_lo; row <= e->broad_hi; row++) {
+        BroadBucket *b = broad_bucket(bp, row);
+        for (int32_t i = 0; i < b->cnt; i++) {
+            if (b->items[i] != e) {
+                continue;
+            }
+            if (i < b->solid_cnt) {
+                b->items[i] = b->items[--b->solid_cnt];
+                i = b->solid_cnt;
+                b->rev++;
+            }
+            b->items[i] = b->items[--b->cnt];
+            break;
+        }
+    }
+    e->in_broad = false;
+}
+
+// Call after changing `aabb`, it is a no-op for entities that are not in the broadphase.
+void broad_update(Broadphase *bp, Entity *e) {
+    if (!e->in_broad) {
+        return;
+    }
+    if (broad_row(e->aabb.y) != e->broad_lo || broad_row(e->aabb.y + e->aabb.height) != e->broad_hi) {
+        broad_remove(bp, e);
+        broad_insert(bp, e);
+    } else if (e->broad_solid) {
+        for (int32_t row = e->broad_lo; row <= e->broad_hi; row++) {
+            broad_bucket(bp, row)->rev++;
+        }
+    }
+}
+
+// Upper bound on what broad_query can return for `r`, to size its output without truncating.
+int32_t broad_query_bound(Broadphase *bp, Rectangle r) {
+    int32_t lo = broad_row(r.y);
+    int32_t hi = broad_row(r.y + r.height);
+    if (hi - lo >= BROAD_BUCKETS) {
+        hi = lo + BROAD_BUCKETS - 1;
+    }
+    int32_t n = 0;
+    for (int32_t row = lo; row <= hi; row++) {
+        n += broad_bucket(bp, row)->cnt;
+    }
+    return n;
+}
+
+// Fills `out` with up to `max` entities overlapping `r` that have `prop` (EP_NIL for any). An entity spanning several
+// rows is only reported from the first row shared with the query, so no result is repeated.
+int32_t broad_query(Broadphase *bp, Rectangle r, EntityProp prop, Entity **out, int32_t max) {
+    int32_t lo = broad_row(r.y);
+    int32_t hi = broad_row(r.y + r.height);
+    int32_t n = 0;
+    bool solid = broad_solid_prop(prop);
+    for (int32_t row = lo; row <= hi; row++) {
+        BroadBucket *b = broad_bucket(bp, row);
+        int32_t end = solid ? b->solid_cnt : b->cnt;
+        for (int32_t i = 0; i < end; i++) {
+            Entity *e = b->items[i];
+            if (row < e->broad_lo || row > e->broad_hi || row != (e->broad_lo > lo ? e->broad_lo : lo)) {
+                continue;
+            }
+            if ((prop != EP_NIL && !en_has_prop(e, prop)) || !CheckCollisionRecs(e->aabb, r)) {
+                continue;
+            }
+            if (n == max) {
+                TraceLog(LOG_WARNING, "broad: query hit more than %d entities", max);
+                return n;
+            }
+            out[n++] = e;
+        }
+    }
+    return n;
+}
+// ;broad
+
+// :query
+// Read-only questions about the level: what a ray or a moving box hits first and which entities are in an area. They
+// use the broadphase and the tiles, never allocate, and the batched versions just run many of them back to back.
+#define QUERY_MAX_HITS 256
+
+typedef struct QueryFilter {
+    EntityProp prop;
+    bool solid_only;
+    Entity *ignore;
+} QueryFilter;
+
+// `en` is NULL when a tile was hit. `t` is the fraction of the cast covered before the hit.
+typedef struct CastHit {
+    bool hit;
+    float t;
+    Vector2 point;
+    Vector2 normal;
+    Entity *en;
+} CastHit;
+
+bool query_accepts(QueryFilter f, Entity *e) {
+    return e != f.ignore && (!f.solid_only || e->is_collidable) && (f.prop == EP_NIL || en_has_prop(e, f.prop));
+}
+
+// Tiles are plain solid platforms.
+bool query_wants_tiles(QueryFilter f) {
+    return f.prop == EP_NIL || f.prop == EP_COLLIDABLE || f.prop == EP_PLAT;
+}
+
+// Entities overlapping `r` that pass the filter.
+int32_t world_query(Broadphase *bp, Rectangle r, QueryFilter f, Entity **out, int32_t max) {
+    int32_t n = broad_query(bp, r, f.prop, out, max);
+    int32_t kept = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (query_accepts(f, out[i])) {
+            out[kept++] = out[i];
+        }
+    }
+    return kept;
+}
+
+// Entry time in [0, 1) of the segment `p` + t * `d` into `b`, -1 on a miss. Touching an edge is not a hit, like
+// CheckCollisionRecs, and a segment starting inside hits at 0 with a zero normal.
+float segment_enter(Vector2 p, Vector2 d, Rectangle b, Vector2 *normal) {
+    float t0 = 0, t1 = 1;
+    Vector2 n = {0};
+    float ps[2] = {p.x, p.y}, ds[2] = {d.x, d.y}, lo[2] = {b.x, b.y}, hi[2] = {b.x + b.width, b.y + b.height};
+    for (int axis = 0; axis < 2; axis++) {
+        if (ds[axis] == 0) {
+            if (ps[axis] <= lo[axis] || ps[axis] >= hi[axis]) {
+                return -1;
+            }
+            continue;
+        }
+        float ta = (lo[axis] - ps[axis]) / ds[axis];
+        float tb = (hi[axis] - ps[axis]) / ds[axis];
+        if (ta > tb) {
+            float tmp = ta;
+            ta = tb;
+            tb = tmp;
+        }
+        if (ta > t0) {
+            t0 = ta;
+            n = axis == 0 ? (Vector2){ds[0] > 0 ? -1 : 1, 0} : (Vector2){0, ds[1] > 0 ? -1 : 1};
+        }
+        t1 = tb < t1 ? tb : t1;
+    }
+    if (t0 >= t1) {
+        return -1;
+    }
+    *normal = n;
+    return t0;
+}
+
+// Sweeps `box` by `delta`. A ray is a box with no size.
+bool world_boxcast(Broadphase *bp, Rectangle box, Vector2 delta, QueryFilter f, CastHit *out) {
+    Rectangle swept = {
+        box.x + (delta.x < 0 ? delta.x : 0),
+        box.y + (delta.y < 0 ? delta.y : 0),
+        box.width + fabsf(delta.x),
+        box.height + fabsf(delta.y),
+    };
+    Vector2 p = {box.x, box.y};
+    *out = (CastHit){.t = 1};
+    Vector2 normal;
+
+    if (query_wants_tiles(f)) {
+        Tilemap *tm = &bp->tiles;
+        uint64_t mask = tile_mask(tile_of(swept.x), tile_of(swept.x + swept.width));
+        for (int32_t row = tile_of(swept.y); mask && row <= tile_of(swept.y + swept.height); row++) {
+            for (uint64_t bits = tilemap_row(tm, row) & mask; bits; bits &= bits - 1) {
+                float x = (TILE_MIN_COL + __builtin_ctzll(bits)) * TILE_SIZE;
+                Rectangle grown = {x - box.width, row * TILE_SIZE - box.height, TILE_SIZE + box.width, TILE_SIZE + box.height};
+                float t = segment_enter(p, delta, grown, &normal);
+                if (t >= 0 && (!out->hit || t < out->t)) {
+                    *out = (CastHit){true, t, {0, 0}, normal, NULL};
+                }
+            }
+        }
+    }
+
+    Entity *ens[QUERY_MAX_HITS];
+    int32_t n = world_query(bp, swept, f, ens, QUERY_MAX_HITS);
+    for (int32_t i = 0; i < n; i++) {
+        Rectangle b = ens[i]->aabb;
+        Rectangle grown = {b.x - box.width, b.y - box.height, b.width + box.width, b.height + box.height};
+        float t = segment_enter(p, delta, grown, &normal);
+        if (t >= 0 && (!out->hit || t < out->t)) {
+            *out = (CastHit){true, t, {0, 0}, normal, ens[i]};
+        }
+    }
+    out->point = (Vector2){p.x + delta.x * out->t, p.y + delta.y * out->t};
+    return out->hit;
+}
+
+bool world_raycast(Broadphase *bp, Vector2 from, Vector2 to, QueryFilter f, CastHit *out) {
+    return world_boxcast(bp, (Rectangle){from.x, from.y, 0, 0}, Vector2Subtract(to, from), f, out);
+}
+
+void world_boxcasts(Broadphase *bp, const Rectangle *boxes, const Vector2 *deltas, int32_t n, QueryFilter f, CastHit *out) {
+    for (int32_t i = 0; i < n; i++) {
+        world_boxcast(bp, boxes[i], deltas[i], f, &out[i]);
+    }
+}
+
+void world_raycasts(Broadphase *bp, const Vector2 *from, const Vector2 *to, int32_t n, QueryFilter f, CastHit *out) {
+    for (int32_t i = 0; i < n; i++) {
+        world_raycast(bp, from[i], to[i], f, &out[i]);
+    }
+}
+// ;query
+
+typedef void (*Action)(Entity *);
+
+int signd(int x) {
+    return (x > 0) - (x < 0);
+}
+
+// Candidates for one move: the entities and a copy of their boxes for the overlap kernel, plus the static tiles.
+typedef struct Collidables {
+    Entity *ens[BROAD_MAX_HITS];
+    AabbSet boxes;
+    Tilemap *tiles;
+} Collidables;
+
+// Stands in for the tilemap in `last_collided`, tiles are plain solid platforms to the callbacks.
+static Entity tile_solid = {.id = EID_PLAT, .is_collidable = true, .is_valid = true};
+
+_Static_assert(AABB_SET_CAP >= BROAD_MAX_HITS, "a full broadphase query must fit in an AabbSet");
+
+// Candidates are solids only, but one can be switched off while it pushes the actor. Such a hit is only reported when
+// nothing solid is hit, so the mover lets the actor through.
+bool en_collides_with(Entity *en, Collidables *c, Vector2 at) {
+    Rectangle to_check = {at.x, at.y, en->aabb.width, en->aabb.height};
+    if (c->tiles && tilemap_solid(c->tiles, to_check)) {
+        en->last_collided = &tile_solid;
+        return true;
+    }
+    int32_t first = aabb_first_hit(&c->boxes, 0, to_check);
+    int32_t i = first;
+    while (i >= 0 && !c->ens[i]->is_collidable) {
+        i = aabb_first_hit(&c->boxes, i + 1, to_check);
+    }
+    if (i < 0) {
+        i = first;
+    }
+    if (i >= 0) {
+        en->last_collided = c->ens[i];
+    }
+    return i >= 0;
+}
+
+// :contacts
+// Actors remember the solids around their last move together with the revisions of the broadphase rows they came
+// from. While the next move stays inside that area and none of those rows changed, the candidates are taken from the
+// cache without touching the broadphase. Invalidating or moving a solid bumps its rows, so stale entries never survive.
+#define CONTACT_MARGIN 24
+#define CONTACT_CAP 8
+#define CONTACT_ROWS 4
+
+typedef struct ContactCache {
+    Rectangle area;
+    int32_t lo;
+    int32_t hi;
+    uint32_t revs[CONTACT_ROWS];
+    Entity *ens[CONTACT_CAP];
+    int32_t cnt;
+    bool valid;
+} ContactCache;
+
+typedef struct ContactStats {
+    unsigned long long hits;
+    unsigned long long misses;
+} ContactStats;
+
+static ContactStats contact_stats = {0};
+
+bool contacts_fresh(ContactCache *c, Broadphase *bp, Rectangle r) {
+    if (!c->valid || !rect_contains(c->area, r)) {
+        return false;
+    }
+    for (int32_t row = c->lo; row <= c->hi; row++) {
+        if (broad_bucket(bp, row)->rev != c->revs[row - c->lo]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void contacts_store(ContactCache *c, Broadphase *bp, Rectangle area, Entity **ens, int32_t cnt) {
+    c->lo = broad_row(area.y);
+    c->hi = broad_row(area.y + area.height);
+    c->valid = cnt <= CONTACT_CAP && c->hi - c->lo < CONTACT_ROWS;
+    if (!c->valid) {
+        return;
+    }
+    c->area = area;
+    for (int32_t row = c->lo; row <= c->hi; row++) {
+        c->revs[row - c->lo] = broad_bucket(bp, row)->rev;
+    }
+    memcpy(c->ens, ens, cnt * sizeof(Entity *));
+    c->cnt = cnt;
+}
+
+// Collidables overlapping `swept`, an area around actor `e`.
+void actor_candidates_in(Broadphase *bp, Entity *e, Rectangle swept, Collidables *out) {
+    ContactCache *cc = e->contacts;
+    int32_t n;
+    if (!cc) {
+        n = broad_query(bp, swept, EP_COLLIDABLE, out->ens, BROAD_MAX_HITS);
+    } else if (contacts_fresh(cc, bp, swept)) {
+        contact_stats.hits++;
+        n = cc->cnt;
+        memcpy(out->ens, cc->ens, n * sizeof(Entity *));
+    } else {
+        contact_stats.misses++;
+        Rectangle area = {
+            swept.x - CONTACT_MARGIN,
+            swept.y - CONTACT_MARGIN,
+            swept.width + 2 * CONTACT_MARGIN,
+            swept.height + 2 * CONTACT_MARGIN,
+        };
+        n = broad_query(bp, area, EP_COLLIDABLE, out->ens, BROAD_MAX_HITS);
+        contacts_store(cc, bp, area, out->ens, n);
+    }
+    out->tiles = &bp->tiles;
+    out->boxes.cnt = 0;
+    for (int32_t i = 0; i < n; i++) {
+        aabb_set_push(&out->boxes, out->ens[i]->aabb);
+    }
+}
+
+// Everything the actor could touch on its way is gathered once per move instead of once per pixel.
+void actor_candidates(Broadphase *bp, Entity *e, int dx, int dy, Collidables *out) {
+    Rectangle swept = {
+        e->pos.x + (dx < 0 ? dx : 0),
+        e->pos.y + (dy < 0 ? dy : 0),
+        e->aabb.width + (dx < 0 ? -dx : dx),
+        e->aabb.height + (dy < 0 ? -dy : dy),
+    };
+    actor_candidates_in(bp, e, swept, out);
+}
+
+bool collidables_any_solid(Collidables *c, Rectangle r) {
+    if (c->tiles && tilemap_solid(c->tiles, r)) {
+        return true;
+    }
+    for (int32_t i = aabb_first_hit(&c->boxes, 0, r); i >= 0; i = aabb_first_hit(&c->boxes, i + 1, r)) {
+        if (c->ens[i]->is_collidable) {
+            return true;
+        }
+    }
+    return false;
+}
+// ;contacts
+
+// :events
+// Gameplay code only records what happened. The queue is drained once after the simulation step, and each consumer
+// (gameplay rules, audio, particles, telemetry) walks the whole batch in push order, so a frame plays out the same way
+// no matter which system noticed the event first.
+#define MAX_EVENTS 256
+
+typedef enum GameEventKind {
+    GE_JUMPED,
+    GE_LANDED,
+    GE_PICKUP,
+    GE_DIED,
+    GE_WON,
+    GE_KIND_CNT,
+} GameEventKind;
+
+// `other` is the pickup or trophy for GE_PICKUP and GE_WON, `pos` is where the effect is shown.
+typedef struct GameEvent {
+    GameEventKind kind;
+    Entity *actor;
+    Entity *other;
+    Vector2 pos;
+} GameEvent;
+
+typedef struct EventQueue {
+    GameEvent items[MAX_EVENTS];
+    int32_t cnt;
+    unsigned long long totals[GE_KIND_CNT];
+} EventQueue;
+
+static EventQueue events = {0};
+
+void events_push(EventQueue *q, GameEvent e) {
+    if (q->cnt == MAX_EVENTS) {
+        TraceLog(LOG_WARNING, "events: more than %d events in one frame", MAX_EVENTS);
+        return;
+    }
+    q->items[q->cnt++] = e;
+}
+
+void events_play_sfx(const EventQueue *q) {
+    for (int32_t i = 0; i < q->cnt; i++) {
+        switch (q->items[i].kind) {
+        case GE_JUMPED:
+            sfx_play(sfx_jump);
+            break;
+        case GE_LANDED:
+            sfx_play(sfx_land);
+            break;
+        case GE_PICKUP:
+            sfx_play(sfx_pickup);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void events_emit_particles(const EventQueue *q) {
+    for (int32_t i = 0; i < q->cnt; i++) {
+        const GameEvent *ev = &q->items[i];
+        switch (ev->kind) {
+        case GE_JUMPED:
+            particles_burst(&particles, ev->pos, burst_jump);
+            break;
+        case GE_LANDED:
+            particles_burst(&particles, ev->pos, burst_land);
+            break;
+        case GE_PICKUP:
+            particles_burst(&particles, ev->pos, burst_pickup);
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void events_count(EventQueue *q) {
+    for (int32_t i = 0; i < q->cnt; i++) {
+        q->totals[q->items[i].kind]++;
+    }
+}
+// ;events
+
+// Returns false when a solid stopped the actor before it covered `amount`.
+bool ActorMoveX(Broadphase *bp, Entity *e, float amount, Action callback) {
+    e->remainder.x += amount;
+    int move = round(e->remainder.x);
+    if (move != 0) {
+        e->remainder.x -= move;
+        int sign = signd(move);
+        Collidables collidables;
+        actor_candidates(bp, e, move, 0, &collidables);
+        while (move != 0) {
+            if (!en_collides_with(e, &collidables, (Vector2){e->pos.x + sign, e->pos.y})) {
+                e->pos.x += sign;
+                move -= sign;
+            } else {
+                Vector2 before = e->pos;
+                if (callback) {
+                    callback(e);
+                }
+                if (!Vector2Equals(before, e->pos)) {
+                    actor_candidates(bp, e, move, 0, &collidables);
+                }
+                if (e->last_collided && !e->last_collided->is_collidable) {
+                    e->pos.x += sign;
+                    move -= sign;
+                } else {
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool ActorMoveY(Broadphase *bp, Entity *e, float amount, Action callback) {
+    e->remainder.y += amount;
+    int move = round(e->remainder.y);
+    if (move != 0) {
+        e->remainder.y -= move;
+        int sign = signd(move);
+        Collidables collidables;
+        actor_candidates(bp, e, 0, move, &collidables);
+        while (move != 0) {
+            if (!en_collides_with(e, &collidables, (Vector2){e->pos.x, e->pos.y + sign})) {
+                e->pos.y += sign;
+                move -= sign;
+            } else {
+                Vector2 before = e->pos;
+                if (callback) {
+                    callback(e);
+                }
+                if (!Vector2Equals(before, e->pos)) {
+                    actor_candidates(bp, e, 0, move, &collidables);
+                }
+                if (e->last_collided != NULL && !e->last_collided->is_collidable) {
+                    e->pos.y += sign;
+                    move -= sign;
+                } else {
+                    if (e->vel.y > 0) {
+                        if (!e->played_land) {
+                            events_push(&events, (GameEvent){GE_LANDED, e, NULL, {e->pos.x + e->size.x / 2, e->pos.y + e->size.y}});
+                            e->played_land = true;
+                        }
+                        e->grounded = true;
+                    }
+                    e->vel.y = 0;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// The ridable solid right under the actor, if any. Platforms only carry the actors that point at them here.
+Entity *actor_riding(Broadphase *bp, Entity *e) {
+    Rectangle feet = {e->pos.x, e->pos.y + 1, e->aabb.width, e->aabb.height};
+    Collidables c;
+    actor_candidates(bp, e, 0, 1, &c);
+    for (int32_t i = 0; i < c.boxes.cnt; i++) {
+        Entity *s = c.ens[i];
+        if (s->is_collidable && en_has_prop(s, EP_RIDABLE) && CheckCollisionRecs(s->aabb, feet)) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+// Runs after the platforms moved: riders are carried by the platform they stand on and any other actor a platform
+// moved into is pushed out along the shorter axis. The pusher is made non solid while pushing, being pinned against
+// another solid calls `squish`.
+void actor_follow(Broadphase *bp, Entity *e, Action squish) {
+    Entity *r = e->riding;
+    if (r && r->is_valid) {
+        if (r->moved.x) {
+            ActorMoveX(bp, e, r->moved.x, NULL);
+        }
+        if (r->moved.y) {
+            ActorMoveY(bp, e, r->moved.y, NULL);
+        }
+    }
+
+    Collidables c;
+    actor_candidates(bp, e, 0, 0, &c);
+    for (int32_t i = 0; i < c.boxes.cnt; i++) {
+        Entity *s = c.ens[i];
+        Rectangle box = {e->pos.x, e->pos.y, e->aabb.width, e->aabb.height};
+        if (!s->is_valid || !s->is_collidable || !en_has_prop(s, EP_RIDABLE) || !CheckCollisionRecs(s->aabb, box)) {
+            continue;
+        }
+        float dx = s->moved.x > 0 ? s->aabb.x + s->aabb.width - box.x : s->moved.x < 0 ? s->aabb.x - (box.x + box.width) : 0;
+        float dy = s->moved.y > 0 ? s->aabb.y + s->aabb.height - box.y : s->moved.y < 0 ? s->aabb.y - (box.y + box.height) : 0;
+        if (dx == 0 && dy == 0) {
+            continue;
+        }
+        s->is_collidable = false;
+        bool pushed = (dy == 0 || (dx != 0 && fabsf(dx) <= fabsf(dy))) ? ActorMoveX(bp, e, dx, NULL) : ActorMoveY(bp, e, dy, NULL);
+        s->is_collidable = true;
+        if (!pushed && squish) {
+            squish(e);
+        }
+    }
+}
+
+// :triggers
+// Pickups, the trophy and the dead zone are trigger volumes. They are not solid, so movement never sees them. Instead,
+// each watching actor queries them once per tick with the bounds it swept over that tick and compares the result with
+// the previous tick, which produces one enter and one exit per overlap.
+#define TRIGGER_MAX 8
+
+typedef void (*TriggerAction)(Entity *self, Entity *trigger, bool entered);
+
+typedef struct TriggerSet {
+    Entity *ens[TRIGGER_MAX];
+    int32_t cnt;
+} TriggerSet;
+
+bool trigger_set_has(const TriggerSet *s, Entity *e) {
+    for (int32_t i = 0; i < s->cnt; i++) {
+        if (s->ens[i] == e) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void actor_triggers(Broadphase *bp, Entity *e, Vector2 from, TriggerSet *inside, TriggerAction callback) {
+    Rectangle swept = {
+        fminf(from.x, e->pos.x),
+        fminf(from.y, e->pos.y),
+        e->aabb.width + fabsf(e->pos.x - from.x),
+        e->aabb.height + fabsf(e->pos.y - from.y),
+    };
+    TriggerSet before = *inside;
+    inside->cnt = world_query(bp, swept, (QueryFilter){.prop = EP_TRIGGER}, inside->ens, TRIGGER_MAX);
+    TriggerSet now = *inside;
+    for (int32_t i = 0; i < before.cnt; i++) {
+        if (!trigger_set_has(&now, before.ens[i])) {
+            callback(e, before.ens[i], false);
+        }
+    }
+    for (int32_t i = 0; i < now.cnt; i++) {
+        if (!trigger_set_has(&before, now.ens[i])) {
+            callback(e, now.ens[i], true);
+        }
+    }
+}
+// ;triggers
+
+// :actors
+// Everything that moves on its own (the player, NPCs) is an actor. Controllers only pick a target horizontal speed and
+// how fast to reach it, then the velocities of all actors are integrated in one pass over parallel arrays and each
+// actor is moved through the broadphase.
+#define MAX_ACTORS 16384
+#define ACTOR_FALL_SPEED 3.6f
+#define ACTOR_GRAVITY 13.0f
+
+typedef int32_t ActorID;
+
+typedef struct Actors {
+    alignas(32) float vx[MAX_ACTORS];
+    alignas(32) float vy[MAX_ACTORS];
+    alignas(32) float target_vx[MAX_ACTORS];
+    alignas(32) float accel[MAX_ACTORS];
+    alignas(32) float fall_speed[MAX_ACTORS];
+    alignas(32) float gravity[MAX_ACTORS];
+    Entity *en[MAX_ACTORS];
+    Action on_collide[MAX_ACTORS];
+    Action on_squish[MAX_ACTORS];
+    TriggerAction on_trigger[MAX_ACTORS];
+    TriggerSet *triggers[MAX_ACTORS];
+    int32_t cnt;
+} Actors;
+
+static Actors actors = {0};
+
+ActorID actors_add(Actors *a, Entity *e, Action on_collide, Action on_squish) {
+    if (a->cnt == MAX_ACTORS) {
+        TraceLog(LOG_WARNING, "actors: more than %d actors", MAX_ACTORS);
+        return -1;
+    }
+    ActorID id = a->cnt++;
+    a->vx[id] = e->vel.x;
+    a->vy[id] = e->vel.y;
+    a->target_vx[id] = 0;
+    a->accel[id] = 0;
+    a->fall_speed[id] = ACTOR_FALL_SPEED;
+    a->gravity[id] = ACTOR_GRAVITY;
+    a->en[id] = e;
+    e->actor = id;
+    e->contacts = arena_alloc(&arena, sizeof(ContactCache));
+    memset(e->contacts, 0, sizeof(ContactCache));
+    a->on_collide[id] = on_collide;
+    a->on_squish[id] = on_squish;
+    a->on_trigger[id] = NULL;
+    a->triggers[id] = NULL;
+    return id;
+}
+
+// Only actors that care about pickups and hazards pay for the trigger query.
+void actors_watch_triggers(Actors *a, ActorID id, TriggerAction on_trigger) {
+    a->triggers[id] = arena_alloc(&arena, sizeof(TriggerSet));
+    a->triggers[id]->cnt = 0;
+    a->on_trigger[id] = on_trigger;
+}
+
+// Approach() for every actor, written as a clamp of the difference so the loop has no branches and vectorizes over the
+// dense arrays. Sleeping actors are integrated too, they just do not move (see actors_update).
+void actors_integrate(Actors *a, float dt) {
+    float *restrict vx = a->vx;
+    float *restrict vy = a->vy;
+    const float *restrict target_vx = a->target_vx;
+    const float *restrict accel = a->accel;
+    const float *restrict fall_speed = a->fall_speed;
+    const float *restrict gravity = a->gravity;
+    for (int32_t i = 0; i < a->cnt; i++) {
+        float ax = accel[i] * dt;
+        float gy = gravity[i] * dt;
+        float dx = target_vx[i] - vx[i];
+        float dy = fall_speed[i] - vy[i];
+        dx = dx < -ax ? -ax : dx;
+        dy = dy < -gy ? -gy : dy;
+        vx[i] += dx > ax ? ax : dx;
+        vy[i] += dy > gy ? gy : dy;
+    }
+}
+
+// Only the listed actors move, the others keep their state until they are listed again.
+void actors_update(Actors *a, Broadphase *bp, const ActorID *ids, int32_t cnt, float dt) {
+    actors_integrate(a, dt);
+    for (int32_t k = 0; k < cnt; k++) {
+        ActorID i = ids[k];
+        Entity *e = a->en[i];
+        if (!e->is_valid) {
+            continue;
+        }
+        actor_follow(bp, e, a->on_squish[i]);
+        Vector2 from = e->pos;
+        e->vel = (Vector2){a->vx[i], a->vy[i]};
+        ActorMoveX(bp, e, e->vel.x, a->on_collide[i]);
+        ActorMoveY(bp, e, e->vel.y, a->on_collide[i]);
+        a->vx[i] = e->vel.x;
+        a->vy[i] = e->vel.y;
+        e->riding = actor_riding(bp, e);
+        if (a->on_trigger[i]) {
+            actor_triggers(bp, e, from, a->triggers[i], a->on_trigger[i]);
+        }
+        if (e->in_broad) {
+            e->aabb.x = e->pos.x;
+            e->aabb.y = e->pos.y;
+            broad_update(bp, e);
+        }
+    }
+}
+// ;actors
+
+typedef enum Screen {
+    S_MENU,
+    S_GAME,
+    S_LOST,
+    S_WON,
+    S_CREDITS,
+    S_DIFFICULTY,
+    S_HOWTO,
+    S_LOADING,
+} Screen;
+
+typedef struct Game {
+    Screen screen;
+    size_t en_cnt;
+    size_t en_cap;
+    Entity **ens;
+    uint32_t en_rev;
+    Broadphase broad;
+    Entity **arch_ens[EID_CNT];
+    size_t arch_cnt[EID_CNT];
+    size_t arch_cap[EID_CNT];
+    bool cut;
+    float cut_y;
+} Game;
+
+static Game game = {0};
+
+void game_add_en(Game *game, Entity *e) {
+    if (game->en_cnt == game->en_cap) {
+        size_t new_cap = game->en_cap ? game->en_cap * 2 : 1024;
+        game->ens = arena_realloc(&arena, game->ens, game->en_cap * sizeof(Entity *), new_cap * sizeof(Entity *));
+        game->en_cap = new_cap;
+    }
+    game->ens[game->en_cnt++] = e;
+    game->en_rev++;
+    broad_insert(&game->broad, e);
+    EntityId id = e->id;
+    if (game->arch_cnt[id] == game->arch_cap[id]) {
+        size_t new_cap = game->arch_cap[id] ? game->arch_cap[id] * 2 : 64;
+        game->arch_ens[id] = arena_realloc(&arena, game->arch_ens[id], game->arch_cap[id] * sizeof(Entity *), new_cap * sizeof(Entity *));
+        game->arch_cap[id] = new_cap;
+    }
+    game->arch_ens[id][game->arch_cnt[id]++] = e;
+}
+
+void game_invalidate_en(Game *game, Entity *e) {
+    if (e->is_valid) {
+        e->is_valid = false;
+        game->en_rev++;
+        broad_remove(&game->broad, e);
+    }
+}
+
+// :arch
+// Dispatch for ARCHETYPES. Lists of entities are sorted by id first so each function gets one homogeneous run.
+struct CmdBuffer;
+
+typedef struct Archetype {
+    void (*emit)(Entity **ens, size_t cnt, struct CmdBuffer *b);
+    void (*minimap)(Entity **ens, size_t cnt);
+    void (*enter)(Entity *self, Entity *trigger);
+    void (*update)(Game *game, Entity **ens, size_t cnt, float dt);
+} Archetype;
+
+static const Archetype archetypes[EID_CNT];
+
+// Stable counting sort by id, `scratch` holds at least `cnt` entries.
+void arch_sort(Entity **ens, size_t cnt, Entity **scratch) {
+    size_t start[EID_CNT + 1] = {0};
+    for (size_t i = 0; i < cnt; i++) {
+        start[ens[i]->id + 1]++;
+    }
+    for (int id = 0; id < EID_CNT; id++) {
+        start[id + 1] += start[id];
+    }
+    for (size_t i = 0; i < cnt; i++) {
+        scratch[start[ens[i]->id]++] = ens[i];
+    }
+    memcpy(ens, scratch, cnt * sizeof(Entity *));
+}
+
+// End of the run of entities sharing the id of ens[begin].
+size_t arch_run_end(Entity **ens, size_t begin, size_t end) {
+    size_t i = begin + 1;
+    while (i < end && ens[i]->id == ens[begin]->id) {
+        i++;
+    }
+    return i;
+}
+
+// Updates the whole level, the game itself only updates the active band (see :activity).
+void game_update_archetypes(Game *game, float dt) {
+    for (int id = 0; id < EID_CNT; id++) {
+        if (archetypes[id].update && game->arch_cnt[id]) {
+            archetypes[id].update(game, game->arch_ens[id], game->arch_cnt[id], dt);
+        }
+    }
+}
+
+// `ens` sorted by id.
+void arch_update_runs(Game *game, Entity **ens, size_t cnt, float dt) {
+    for (size_t i = 0; i < cnt;) {
+        size_t end = arch_run_end(ens, i, cnt);
+        const Archetype *arch = &archetypes[ens[i]->id];
+        if (arch->update) {
+            arch->update(game, ens + i, end - i, dt);
+        }
+        i = end;
+    }
+}
+// ;arch
+
+// :activity
+// Only two bands are simulated: the camera view and a strip around the dead zone, both grown by ACTIVE_MARGIN. They
+// merge into one while the dead zone is close to the view. The dead zone only follows the last checkpoint, so the
+// climb between it and the view sleeps and the update cost follows what is around the player instead of the tower
+// height. Entities outside the bands sleep where they are: movers keep their phase, actors their velocity.
+#define ACTIVE_MARGIN 512
+#define MAX_ACTIVE 4096
+
+typedef struct Activity {
+    Rectangle bands[2];
+    int32_t band_cnt;
+    Entity *ens[MAX_ACTIVE];
+    Entity *scratch[MAX_ACTIVE];
+    int32_t cnt;
+    ActorID actors[MAX_ACTIVE + 1];
+    int32_t actor_cnt;
+} Activity;
+
+static Activity activity = {0};
+
+// `always` is an actor that is simulated wherever it is (the player), -1 for none.
+void activity_update(Activity *act, Game *game, Rectangle view, float dead_zone_y, ActorID always) {
+    // A sleeping platform must not keep carrying its riders by its last step.
+    for (int32_t i = 0; i < act->cnt; i++) {
+        act->ens[i]->moved = (Vector2){0};
+    }
+    float x = view.x - ACTIVE_MARGIN;
+    float w = view.width + 2 * ACTIVE_MARGIN;
+    float top = view.y - ACTIVE_MARGIN;
+    float bottom = view.y + view.height + ACTIVE_MARGIN;
+    float dz_top = dead_zone_y - ACTIVE_MARGIN;
+    float dz_bottom = dead_zone_y + ACTIVE_MARGIN;
+    if (dz_top <= bottom && dz_bottom >= top) {
+        top = fminf(top, dz_top);
+        bottom = fmaxf(bottom, dz_bottom);
+        act->band_cnt = 1;
+    } else {
+        act->bands[1] = (Rectangle){x, dz_top, w, dz_bottom - dz_top};
+        act->band_cnt = 2;
+    }
+    act->bands[0] = (Rectangle){x, top, w, bottom - top};
+    act->cnt = world_query(&game->broad, act->bands[0], (QueryFilter){0}, act->ens, MAX_ACTIVE);
+    if (act->band_cnt == 2) {
+        int32_t first = act->cnt;
+        int32_t n = world_query(&game->broad, act->bands[1], (QueryFilter){0}, act->ens + first, MAX_ACTIVE - first);
+        // Only something taller than the gap can be in both.
+        for (int32_t i = first; i < first + n; i++) {
+            if (!CheckCollisionRecs(act->ens[i]->aabb, act->bands[0])) {
+                act->ens[act->cnt++] = act->ens[i];
+            }
+        }
+    }
+    arch_sort(act->ens, act->cnt, act->scratch);
+    act->actor_cnt = 0;
+    if (always >= 0) {
+        act->actors[act->actor_cnt++] = always;
+    }
+    for (int32_t i = 0; i < act->cnt; i++) {
+        if (act->ens[i]->actor >= 0 && act->ens[i]->actor != always) {
+            act->actors[act->actor_cnt++] = act->ens[i]->actor;
+        }
+    }
+}
+
+// Invalidates the entities under `y`. Everything under the previous line is already gone, so only the strip down to
+// it is searched, plus ACTIVE_MARGIN for active entities that moved down since.
+void game_cut_below(Game *game, float y) {
+    float bottom = (game->cut && game->cut_y > y ? game->cut_y : y) + ACTIVE_MARGIN;
+    for (float y0 = y; y0 < bottom; y0 += 1024) {
+        Entity *found[QUERY_MAX_HITS];
+        Rectangle strip = {-1e6f, y0, 2e6f, fminf(1024, bottom - y0)};
+        int32_t n = world_query(&game->broad, strip, (QueryFilter){0}, found, QUERY_MAX_HITS);
+        for (int32_t i = 0; i < n; i++) {
+            if (found[i]->pos.y > y) {
+                game_invalidate_en(game, found[i]);
+            }
+        }
+    }
+    game->cut = true;
+    game->cut_y = y;
+}
+// ;activity
+
+// :player
+typedef enum PlayerState {
+    PS_IDLE,
+    PS_WALK,
+} PlayerState;
+
+typedef struct Player {
+    AnimID anim;
+    ActorID actor;
+    PlayerState state;
+    PlayerState prevState;
+    float jump_power;
+    TimerID boost;
+} Player;
+
+#define JUMP_BOOST_MAX 20
+
+// The coffee jump only lasts as long as the boost.
+void player_boost_expired(void *arg) {
+    Player *data = arg;
+    if (data->jump_power == -10) {
+        data->jump_power /= 2;
+    }
+}
+
+void player_set_boost(Player *data, float seconds) {
+    timer_cancel(&timers, data->boost);
+    data->boost = timer_after(&timers, seconds, player_boost_expired, data);
+}
+
+Entity *player_init() {
+    Entity *e = arena_alloc(&arena, sizeof(Entity));
+    memset(e, 0, sizeof(Entity));
+    en_setup(e, 0, -24, 18, 24);
+    e->user_data = arena_alloc(&arena, sizeof(Player));
+    Player *data = (Player *)e->user_data;
+    data->state = PS_IDLE;
+    data->jump_power = -5;
+    e->id = EID_PLAYER;
+    return e;
+}
+
+// Falling out of the level or getting crushed by a platform, see player_on_event for what it costs.
+void player_die(Entity *self) {
+    events_push(&events, (GameEvent){GE_DIED, self, NULL, self->pos});
+}
+
+Vector2 en_center(Entity *e) {
+    return (Vector2){e->pos.x + e->size.x / 2, e->pos.y + e->size.y / 2};
+}
+
+void enter_dead_zone(Entity *self, Entity *trigger) {
+    (void)trigger;
+    player_die(self);
+}
+
+void enter_pickup(Entity *self, Entity *trigger) {
+    events_push(&events, (GameEvent){GE_PICKUP, self, trigger, en_center(trigger)});
+}
+
+void enter_trophy(Entity *self, Entity *trigger) {
+    events_push(&events, (GameEvent){GE_WON, self, trigger, en_center(trigger)});
+}
+
+void onTrigger(Entity *self, Entity *trigger, bool entered) {
+    if (entered && archetypes[trigger->id].enter) {
+        archetypes[trigger->id].enter(self, trigger);
+    }
+}
+
+// Gameplay rules for the player's events. Dying costs the run unless the boost is still up.
+void player_on_event(const GameEvent *ev) {
+    Entity *self = ev->actor;
+    Player *data = (Player *)self->user_data;
+    switch (ev->kind) {
+    case GE_DIED:
+        if (timer_left(&timers, data->boost) <= 0) {
+            game.screen = S_LOST;
+        } else {
+            self->pos = self->respawn;
+            self->riding = NULL;
+        }
+        break;
+    case GE_PICKUP:
+        if (ev->other->id == EID_JUMP_COFFEE) {
+            data->jump_power = -10;
+            player_set_boost(data, fminf(timer_left(&timers, data->boost) + 4, JUMP_BOOST_MAX));
+        } else {
+            self->respawn = (Vector2){self->pos.x, (self->pos.y + self->aabb.height - self->aabb.height)};
+        }
+        game_invalidate_en(&game, ev->other);
+        break;
+    case GE_WON:
+        game.screen = S_WON;
+        break;
+    default:
+        break;
+    }
+}
+
+// Only reads input and steers the player's actor, moving happens in actors_update.
+void player_update(Entity *player, ClipID walk, ClipID idle) {
+    player->aabb.x = player->pos.x + 4;
+    player->aabb.y = player->pos.y;
+    Player *data = (Player *)player->user_data;
+    ActorID id = data->actor;
+
+    if (IsKeyDown(KEY_A)) {
+        animator.speed[data->anim] = Approach(animator.speed[data->anim], .1, 4 * frame_time());
+        actors.target_vx[id] = -2.0;
+        actors.accel[id] = 22;
+        player->flip = true;
+        data->state = PS_WALK;
+    } else if (IsKeyDown(KEY_D)) {
+        animator.speed[data->anim] = Approach(animator.speed[data->anim], .1, 4 * frame_time());
+        actors.target_vx[id] = 2.0;
+        actors.accel[id] = 22;
+        player->flip = false;
+        data->state = PS_WALK;
+    } else {
+        actors.target_vx[id] = 0;
+        actors.accel[id] = player->grounded ? 10 : 12;
+        data->state = PS_IDLE;
+    }
+
+    if (IsKeyPressed(KEY_SPACE) && player->grounded) {
+        player->grounded = false;
+        player->played_land = false;
+        actors.vy[id] = data->jump_power;
+        events_push(&events, (GameEvent){GE_JUMPED, player, NULL, {player->pos.x + player->size.x / 2, player->pos.y + player->size.y}});
+    }
+
+    if (data->prevState != data->state) {
+        switch (data->state) {
+        case PS_IDLE:
+            anim_play(&animator, data->anim, idle);
+            break;
+        case PS_WALK:
+            anim_play(&animator, data->anim, walk);
+            break;
+        default:
+            break;
+        }
+        data->prevState = data->state;
+    }
+}
+
+// Runs once per frame after the simulation step.
+void game_events_flush(EventQueue *q) {
+    for (int32_t i = 0; i < q->cnt; i++) {
+        if (q->items[i].actor->id == EID_PLAYER) {
+            player_on_event(&q->items[i]);
+        }
+    }
+    events_play_sfx(q);
+    events_emit_particles(q);
+    events_count(q);
+    q->cnt = 0;
+}
+// ;player
+
+Entity *en_trigger(float x, float y, float w, float h) {
+    Entity *e = arena_alloc(&arena, sizeof(Entity));
+    memset(e, 0, sizeof(Entity));
+    en_setup(e, x, y, w, h);
+    en_add_props(e, EP_TRIGGER);
+    return e;
+}
+
+void en_move_y(Entity *en, float y) {
+    if (en->pos.y == y && en->aabb.y == y) {
+        return;
+    }
+    en->pos.y = y;
+    en->aabb.y = y;
+    broad_update(&game.broad, en);
+}
+
+void trophies_update(Game *game, Entity **ens, size_t cnt, float dt) {
+    (void)game;
+    (void)dt;
+    for (size_t i = 0; i < cnt; i++) {
+        if (ens[i]->is_valid) {
+            en_move_y(ens[i], ens[i]->pos.y - sinf(timers_now(&timers) * 3));
+        }
+    }
+}
+
+Entity *gen_plat(float x, float y, PlatType type, TextureID texId) {
+    Entity *e = arena_alloc(&arena, sizeof(Entity));
+    memset(e, 0, sizeof(Entity));
+    switch (type) {
+    case PT_ONE_WIDE:
+        en_setup(e, x, y, 16, 16);
+        break;
+    case PT_TWO_WIDE:
+        en_setup(e, x, y, 16 * 2, 16);
+        break;
+    case PT_THREE_WIDE:
+        en_setup(e, x, y, 16 * 3, 16);
+        break;
+    case PT_FINAL:
+        en_setup(e, x, y, 16 * 6, 16 * 3);
+        break;
+    }
+    en_add_props(e, EP_COLLIDABLE);
+    en_add_props(e, EP_PLAT);
+    e->id = EID_PLAT;
+    e->texId = texId;
+    e->is_collidable = true;
+    return e;
+}
+
+// Static platforms go to the tilemap, the ones it cannot hold stay plain entities in the broadphase. `en_rev` still
+// tells the minimap to redraw them.
+void game_add_plat(Game *game, float x, float y, PlatType type) {
+    if (!tilemap_add(&game->broad.tiles, x, y, type)) {
+        game_add_en(game, gen_plat(x, y, type, game->broad.tiles.tex));
+    }
+    game->en_rev++;
+}
+
+// :mover
+// Moving platforms ease back and forth between `origin` and `origin + extent` and only ever move by whole pixels, the
+// actors standing on them follow through `actor_follow`.
+typedef struct Mover {
+    Vector2 origin;
+    Vector2 extent;
+    float period;
+    float time;
+} Mover;
+
+Entity *gen_mover(float x, float y, PlatType type, Vector2 extent, float period, TextureID texId) {
+    Entity *e = gen_plat(x, y, type, texId);
+    e->id = EID_MOVING_PLAT;
+    en_add_props(e, EP_RIDABLE);
+    Mover *m = arena_alloc(&arena, sizeof(Mover));
+    *m = (Mover){(Vector2){x, y}, extent, period, 0};
+    e->user_data = m;
+    return e;
+}
+
+void movers_update(Game *game, Entity **ens, size_t cnt, float dt) {
+    for (size_t i = 0; i < cnt; i++) {
+        Entity *en = ens[i];
+        en->moved = (Vector2){0};
+        if (!en->is_valid) {
+            continue;
+        }
+        Mover *m = en->user_data;
+        m->time += dt;
+        float t = 0.5f - 0.5f * cosf(m->time * 2 * PI / m->period);
+        Vector2 target = Vector2Add(m->origin, Vector2Scale(m->extent, t));
+        en->moved = (Vector2){roundf(target.x - en->pos.x), roundf(target.y - en->pos.y)};
+        en->pos = Vector2Add(en->pos, en->moved);
+        en->aabb.x = en->pos.x;
+        en->aabb.y = en->pos.y;
+        broad_update(&game->broad, en);
+    }
+}
+// ;mover
+
+// :walker
+// NPCs that pace along their platform and turn around at walls and ledges.
+#define WALKER_SPEED 0.6f
+#define WALKER_ACCEL 8.0f
+
+typedef struct Walker {
+    float dir;
+    ActorID actor;
+} Walker;
+
+Entity *gen_walker(float x, float y, ClipID clip) {
+    Entity *e = arena_alloc(&arena, sizeof(Entity));
+    memset(e, 0, sizeof(Entity));
+    en_setup(e, x, y, 18, 24);
+    e->id = EID_WALKER;
+    e->anim = anim_add(&animator, clip);
+    Walker *w = arena_alloc(&arena, sizeof(Walker));
+    w->dir = GetRandomValue(0, 1) ? 1 : -1;
+    e->user_data = w;
+    w->actor = actors_add(&actors, e, NULL, NULL);
+    return e;
+}
+
+void walkers_think(Game *game, Entity **ens, size_t cnt, float dt) {
+    (void)dt;
+    Actors *a = &actors;
+    Broadphase *bp = &game->broad;
+    for (size_t k = 0; k < cnt; k++) {
+        Entity *e = ens[k];
+        Walker *w = e->user_data;
+        if (!e->is_valid || w->actor < 0) {
+            continue;
+        }
+        ActorID i = w->actor;
+        if (e->grounded) {
+            float ahead = w->dir > 0 ? e->pos.x + e->aabb.width : e->pos.x - 1;
+            Rectangle wall = {ahead, e->pos.y, 1, e->aabb.height - 1};
+            Rectangle floor = {ahead, e->pos.y + e->aabb.height, 1, 1};
+            Collidables c;
+            actor_candidates_in(bp, e, (Rectangle){ahead, e->pos.y, 1, e->aabb.height + 1}, &c);
+            if (collidables_any_solid(&c, wall) || !collidables_any_solid(&c, floor)) {
+                w->dir = -w->dir;
+            }
+        }
+        a->target_vx[i] = w->dir * WALKER_SPEED;
+        a->accel[i] = WALKER_ACCEL;
+        e->flip = w->dir < 0;
+    }
+}
+// ;walker
+
+// :cmd
+// World drawing is split into building a list of draw commands and submitting it. The visible set is culled and sorted
+// on the main thread, then building (picking sprites for it) has no GL calls and runs on worker threads into per-thread
+// buffers once the set is large enough. Submission stays on the main thread.
+#define MAX_CMDS_PER_EN 18
+#define RENDER_WORKERS 4
+#define PARALLEL_BUILD_MIN 256
+
+typedef enum DrawCmdKind {
+    DC_TEX,
+    DC_RECT,
+} DrawCmdKind;
+
+typedef struct DrawCmd {
+    DrawCmdKind kind;
+    TextureID tex;
+    Rectangle src;
+    Rectangle dst;
+    Color tint;
+} DrawCmd;
+
+typedef struct CmdBuffer {
+    DrawCmd *cmds;
+    size_t cnt;
+    size_t cap;
+} CmdBuffer;
+
+void cmd_reserve(CmdBuffer *b, size_t cap) {
+    if (cap <= b->cap) {
+        return;
+    }
+    size_t new_cap = b->cap * 2 > cap ? b->cap * 2 : cap;
+    b->cmds = arena_realloc(&arena, b->cmds, b->cap * sizeof(DrawCmd), new_cap * sizeof(DrawCmd));
+    b->cap = new_cap;
+}
+
+void cmd_tex(CmdBuffer *b, TextureID tex, Rectangle src, Vector2 pos, Color tint) {
+    if (b->cnt < b->cap) {
+        b->cmds[b->cnt++] = (DrawCmd){DC_TEX, tex, src, (Rectangle){pos.x, pos.y, fabsf(src.width), fabsf(src.height)}, tint};
+    }
+}
+
+void cmd_rect(CmdBuffer *b, Rectangle rect, Color tint) {
+    if (b->cnt < b->cap) {
+        b->cmds[b->cnt++] = (DrawCmd){DC_RECT, 0, (Rectangle){0}, rect, tint};
+    }
+}
+
+void cmd_submit(CmdBuffer *b) {
+    for (size_t i = 0; i < b->cnt; i++) {
+        DrawCmd *c = &b->cmds[i];
+        switch (c->kind) {
+        case DC_TEX:
+            DrawTexturePro(get_tex(c->tex), c->src, c->dst, (Vector2){0, 0}, 0, c->tint);
+            break;
+        case DC_RECT:
+            DrawRectangleRec(c->dst, c->tint);
+            break;
+        }
+    }
+}
+
+void plat_emit_at(CmdBuffer *b, TextureID tex, Vector2 pos, PlatType type) {
+    switch (type) {
+    case PT_ONE_WIDE:
+        cmd_tex(b, tex, (Rectangle){8 * 16, 16, 16, 16}, (Vector2){pos.x, pos.y}, WHITE);
+        break;
+    case PT_TWO_WIDE:
+        cmd_tex(b, tex, (Rectangle){8 * 16, 16 * 3, 16, 16}, (Vector2){pos.x, pos.y}, WHITE);
+        cmd_tex(b, tex, (Rectangle){10 * 16, 16 * 3, 16, 16}, (Vector2){pos.x + 16, pos.y}, WHITE);
+        break;
+    case PT_THREE_WIDE:
+        cmd_tex(b, tex, (Rectangle){8 * 16, 16 * 3, 16, 16}, (Vector2){pos.x, pos.y}, WHITE);
+        cmd_tex(b, tex, (Rectangle){9 * 16, 16 * 3, 16, 16}, (Vector2){pos.x + 16, pos.y}, WHITE);
+        cmd_tex(b, tex, (Rectangle){10 * 16, 16 * 3, 16, 16}, (Vector2){pos.x + 32, pos.y}, WHITE);
+        break;
+    case PT_FINAL:
+        for (int x = 0; x < 6; x++) {
+            for (int y = 0; y < 3; y++) {
+                cmd_tex(b, tex, (Rectangle){(1 + x) * 16, (2 + y) * 16, 16, 16}, (Vector2){pos.x + (x * 16), pos.y + (y * 16)}, WHITE);
+            }
+        }
+    }
+}
+
+void plat_emit(Entity *self, CmdBuffer *b) {
+    plat_emit_at(b, self->texId, self->pos, (self->aabb.width / 16) - 1);
+}
+
+void plat_render(Entity *self) {
+    DrawCmd cmds[MAX_CMDS_PER_EN];
+    CmdBuffer b = {cmds, 0, MAX_CMDS_PER_EN};
+    plat_emit(self, &b);
+    cmd_submit(&b);
+}
+
+// Draws the static platforms overlapping `area`. A platform is at most 3 rows high, so the chunk above the first
+// visible row is only needed for its last rows.
+void tilemap_draw(Tilemap *t, Rectangle area) {
+    DrawCmd cmds[MAX_CMDS_PER_EN];
+    CmdBuffer b = {cmds, 0, MAX_CMDS_PER_EN};
+    int32_t first = tile_chunk_of(tile_of(area.y) - 2);
+    int32_t last = tile_chunk_of(tile_of(area.y + area.height));
+    for (int32_t k = first; k <= last; k++) {
+        TileChunk *c = tilemap_chunk(t, k, false);
+        for (int32_t i = 0; c && i < c->plat_cnt; i++) {
+            StaticPlat *p = &c->plats[i];
+            Rectangle r = static_plat_rect(k, p);
+            if (p->removed || !CheckCollisionRecs(r, area)) {
+                continue;
+            }
+            b.cnt = 0;
+            plat_emit_at(&b, t->tex, (Vector2){r.x, r.y}, p->type);
+            cmd_submit(&b);
+        }
+    }
+}
+
+void plats_emit(Entity **ens, size_t cnt, CmdBuffer *b) {
+    for (size_t i = 0; i < cnt; i++) {
+        plat_emit(ens[i], b);
+    }
+}
+
+void sprites_emit(Entity **ens, size_t cnt, CmdBuffer *b) {
+    for (size_t i = 0; i < cnt; i++) {
+        Texture2D tex = get_tex(ens[i]->texId);
+        cmd_tex(b, ens[i]->texId, (Rectangle){0, 0, tex.width, tex.height}, ens[i]->pos, WHITE);
+    }
+}
+
+void checkpoints_emit(Entity **ens, size_t cnt, CmdBuffer *b) {
+    for (size_t i = 0; i < cnt; i++) {
+        Texture2D tex = get_tex(ens[i]->texId);
+        cmd_tex(b, ens[i]->texId, (Rectangle){0, 0, tex.width, tex.height}, ens[i]->pos, GREEN);
+    }
+}
+
+void dead_zones_emit(Entity **ens, size_t cnt, CmdBuffer *b) {
+    for (size_t i = 0; i < cnt; i++) {
+        cmd_rect(b, (Rectangle){ens[i]->pos.x, ens[i]->pos.y, ens[i]->size.x, ens[i]->size.y}, RED);
+    }
+}
+
+// Animated sprites stand on the bottom of their box.
+void animated_emit(Entity **ens, size_t cnt, CmdBuffer *b) {
+    for (size_t i = 0; i < cnt; i++) {
+        Entity *en = ens[i];
+        Rectangle src = anim_frame(&animator, en->anim, en->flip);
+        cmd_tex(b, anim_tex(&animator, en->anim), src, (Vector2){en->pos.x, en->pos.y + en->size.y - src.height}, WHITE);
+    }
+}
+
+typedef struct RenderJob {
+    Entity **ens;
+    size_t begin;
+    size_t end;
+    CmdBuffer *out;
+} RenderJob;
+
+// `ens` is already culled and sorted by id.
+void render_job_run(RenderJob *job) {
+    job->out->cnt = 0;
+    for (size_t i = job->begin; i < job->end;) {
+        size_t end = arch_run_end(job->ens, i, job->end);
+        const Archetype *arch = &archetypes[job->ens[i]->id];
+        if (arch->emit) {
+            arch->emit(job->ens + i, end - i, job->out);
+        }
+        i = end;
+    }
+}
+
+typedef struct RenderPool {
+#ifdef HAS_THREADS
+    thrd_t threads[RENDER_WORKERS];
+    mtx_t lock;
+    cnd_t wake;
+    cnd_t done;
+#endif
+    bool running;
+    bool quit;
+    int thread_cnt;
+    int generation;
+    int pending;
+    int active;
+    RenderJob jobs[RENDER_WORKERS];
+    CmdBuffer bufs[RENDER_WORKERS];
+} RenderPool;
+
+static RenderPool render_pool = {0};
+
+// What the frame draws, sorted by id. Grown to the broadphase bound of the area so a crowded view is never cut short.
+typedef struct VisibleSet {
+    Entity **ens;
+    Entity **scratch;
+    int32_t cnt;
+    int32_t cap;
+} VisibleSet;
+
+static VisibleSet render_visible = {0};
+
+void visible_collect(VisibleSet *v, Broadphase *bp, Rectangle area) {
+    int32_t bound = broad_query_bound(bp, area);
+    if (bound > v->cap) {
+        int32_t new_cap = v->cap * 2 > bound ? v->cap * 2 : bound;
+        v->ens = arena_realloc(&arena, v->ens, v->cap * sizeof(Entity *), new_cap * sizeof(Entity *));
+        v->scratch = arena_realloc(&arena, v->scratch, v->cap * sizeof(Entity *), new_cap * sizeof(Entity *));
+        v->cap = new_cap;
+    }
+    v->cnt = world_query(bp, area, (QueryFilter){0}, v->ens, v->cap);
+    arch_sort(v->ens, v->cnt, v->scratch);
+}
+
+#ifdef HAS_THREADS
+int render_worker(void *arg) {
+    int idx = (int)(intptr_t)arg;
+    int seen = 0;
+    for (;;) {
+        mtx_lock(&render_pool.lock);
+        while (render_pool.generation == seen && !render_pool.quit) {
+            cnd_wait(&render_pool.wake, &render_pool.lock);
+        }
+        if (render_pool.quit) {
+            mtx_unlock(&render_pool.lock);
+            return 0;
+        }
+        seen = render_pool.generation;
+        mtx_unlock(&render_pool.lock);
+
+        render_job_run(&render_pool.jobs[idx]);
+
+        mtx_lock(&render_pool.lock);
+        if (--render_pool.pending == 0) {
+            cnd_signal(&render_pool.done);
+        }
+        mtx_unlock(&render_pool.lock);
+    }
+    return 0;
+}
+#endif
+
+// Job 0 always runs on the calling thread, workers take jobs 1..RENDER_WORKERS-1.
+void render_pool_init(RenderPool *pool) {
+    pool->running = false;
+    pool->quit = false;
+    pool->thread_cnt = 0;
+#ifdef HAS_THREADS
+    if (mtx_init(&pool->lock, mtx_plain) != thrd_success || cnd_init(&pool->wake) != thrd_success || cnd_init(&pool->done) != thrd_success) {
+        return;
+    }
+    for (int i = 1; i < RENDER_WORKERS; i++) {
+        if (thrd_create(&pool->threads[i], render_worker, (void *)(intptr_t)i) != thrd_success) {
+            TraceLog(LOG_WARNING, "render: failed to start worker %d, building draw commands on the main thread", i);
+            return;
+        }
+        pool->thread_cnt = i;
+    }
+    pool->running = true;
+#endif
+}
+
+// Wakes the workers to exit and joins them.
+void render_pool_shutdown(RenderPool *pool) {
+    pool->running = false;
+#ifdef HAS_THREADS
+    if (pool->thread_cnt == 0) {
+        return;
+    }
+    mtx_lock(&pool->lock);
+    pool->quit = true;
+    cnd_broadcast(&pool->wake);
+    mtx_unlock(&pool->lock);
+    for (int i = 1; i <= pool->thread_cnt; i++) {
+        thrd_join(pool->threads[i], NULL);
+    }
+    pool->thread_cnt = 0;
+    mtx_destroy(&pool->lock);
+    cnd_destroy(&pool->wake);
+    cnd_destroy(&pool->done);
+#endif
+}
+
+void render_cmds_build(RenderPool *pool, Entity **ens, size_t en_cnt) {
+    int jobs = (pool->running && en_cnt >= PARALLEL_BUILD_MIN) ? RENDER_WORKERS : 1;
+    size_t per_job = (en_cnt + jobs - 1) / jobs;
+    for (int j = 0; j < jobs; j++) {
+        size_t begin = j * per_job < en_cnt ? j * per_job : en_cnt;
+        size_t end = begin + per_job < en_cnt ? begin + per_job : en_cnt;
+        cmd_reserve(&pool->bufs[j], (end - begin) * MAX_CMDS_PER_EN);
+        pool->jobs[j] = (RenderJob){ens, begin, end, &pool->bufs[j]};
+    }
+    pool->active = jobs;
+    if (jobs == 1) {
+        render_job_run(&pool->jobs[0]);
+        return;
+    }
+#ifdef HAS_THREADS
+    mtx_lock(&pool->lock);
+    pool->pending = jobs - 1;
+    pool->generation++;
+    cnd_broadcast(&pool->wake);
+    mtx_unlock(&pool->lock);
+
+    render_job_run(&pool->jobs[0]);
+
+    mtx_lock(&pool->lock);
+    while (pool->pending > 0) {
+        cnd_wait(&pool->done, &pool->lock);
+    }
+    mtx_unlock(&pool->lock);
+#endif
+}
+
+// Buffers are submitted in job order, so the draw order matches `ens` like a single threaded build would.
+void render_cmds_submit(RenderPool *pool) {
+    for (int j = 0; j < pool->active; j++) {
+        cmd_submit(&pool->bufs[j]);
+    }
+}
+// ;cmd
+
+Entity *gen_pickup(float x, float y, EntityId id, TextureID texId) {
+    Entity *e = arena_alloc(&arena, sizeof(Entity));
+    memset(e, 0, sizeof(Entity));
+    en_setup(e, x, y, 16, 16);
+    e->id = id;
+    e->texId = texId;
+    en_add_props(e, EP_TRIGGER);
+    return e;
+}
+// :minimap
+#define MINIMAP_SCALE 0.25f
+#define MINIMAP_UPDATE_RATE 15.0f
+#define MINIMAP_MAX_SHOWN 1024
+
+// The minimap keeps its own small target. Platforms live in a cached static layer that covers more than the visible
+// area and is only re-rendered when the entity set changes or the view leaves it, pickups and the player are drawn on
+// top of it as plain rectangles at `update_rate` Hz.
+typedef struct Minimap {
+    RenderTexture2D target;
+    RenderTexture2D statics;
+    Rectangle statics_area;
+    uint32_t statics_rev;
+    float update_rate;
+    float timer;
+} Minimap;
+
+void minimap_init(Minimap *mm, int width, int height, float update_rate) {
+    mm->target = LoadRenderTexture(width, height);
+    mm->statics = LoadRenderTexture(width * 2, height * 3);
+    mm->statics_area = (Rectangle){0};
+    mm->statics_rev = 0;
+    mm->update_rate = update_rate;
+    mm->timer = 0;
+}
+
+void minimap_rebuild_statics(Minimap *mm, Game *game, Vector2 center) {
+    float w = mm->statics.texture.width / MINIMAP_SCALE;
+    float h = mm->statics.texture.height / MINIMAP_SCALE;
+    mm->statics_area = (Rectangle){center.x - w / 2, center.y - h / 2, w, h};
+    mm->statics_rev = game->en_rev;
+
+    Camera2D statics_cam = {
+        .offset = (Vector2){mm->statics.texture.width / 2, mm->statics.texture.height / 2},
+        .target = center,
+        .zoom = MINIMAP_SCALE,
+    };
+    BeginTextureMode(mm->statics);
+    {
+        ClearBackground(BLANK);
+        BeginMode2D(statics_cam);
+        {
+            tilemap_draw(&game->broad.tiles, mm->statics_area);
+        }
+        EndMode2D();
+    }
+    EndTextureMode();
+}
+
+void plats_minimap(Entity **ens, size_t cnt) {
+    for (size_t i = 0; i < cnt; i++) {
+        plat_render(ens[i]);
+    }
+}
+
+void pickups_minimap(Entity **ens, size_t cnt) {
+    for (size_t i = 0; i < cnt; i++) {
+        DrawRectangleRec(ens[i]->aabb, WHITE);
+    }
+}
+
+void checkpoints_minimap(Entity **ens, size_t cnt) {
+    for (size_t i = 0; i < cnt; i++) {
+        DrawRectangleRec(ens[i]->aabb, GREEN);
+    }
+}
+
+void minimap_update(Minimap *mm, Game *game, Entity *player, Vector2 center, float dt) {
+    mm->timer -= dt;
+    if (mm->timer > 0) {
+        return;
+    }
+    mm->timer = 1.0f / mm->update_rate;
+
+    int tw = mm->target.texture.width;
+    int th = mm->target.texture.height;
+    Rectangle view = {center.x - tw / MINIMAP_SCALE / 2, center.y - th / MINIMAP_SCALE / 2, tw / MINIMAP_SCALE, th / MINIMAP_SCALE};
+    if (mm->statics_rev != game->en_rev || !rect_contains(mm->statics_area, view)) {
+        minimap_rebuild_statics(mm, game, center);
+    }
+
+    float sx = (view.x - mm->statics_area.x) * MINIMAP_SCALE;
+    float sy = (view.y - mm->statics_area.y) * MINIMAP_SCALE;
+    Camera2D overlay_cam = {
+        .offset = (Vector2){tw / 2, th / 2},
+        .target = center,
+        .zoom = MINIMAP_SCALE,
+    };
+    BeginTextureMode(mm->target);
+    {
+        ClearBackground(BLANK);
+        DrawTextureRec(mm->statics.texture, (Rectangle){sx, mm->statics.texture.height - sy - th, tw, -th}, (Vector2){0, 0}, WHITE);
+        BeginMode2D(overlay_cam);
+        {
+            Entity *shown[MINIMAP_MAX_SHOWN];
+            Entity *scratch[MINIMAP_MAX_SHOWN];
+            int32_t cnt = world_query(&game->broad, view, (QueryFilter){0}, shown, MINIMAP_MAX_SHOWN);
+            arch_sort(shown, cnt, scratch);
+            for (size_t i = 0; i < (size_t)cnt;) {
+                size_t end = arch_run_end(shown, i, cnt);
+                const Archetype *arch = &archetypes[shown[i]->id];
+                if (arch->minimap) {
+                    arch->minimap(shown + i, end - i);
+                }
+                i = end;
+            }
+            DrawRectangleRec(player->aabb, RED);
+        }
+        EndMode2D();
+    }
+    EndTextureMode();
+}
+
+void minimap_draw(Minimap *mm, Vector2 pos) {
+    Texture2D tex = mm->target.texture;
+    DrawTextureRec(tex, (Rectangle){0, 0, tex.width, -tex.height}, pos, WHITE);
+    DrawRectangleLinesEx((Rectangle){pos.x, pos.y, tex.width, tex.height}, 2.0, BLACK);
+}
+// ;minimap
+
+// :view
+// The world is rendered into a low resolution target at one texel per world pixel and scaled up to the window by an
+// integer factor. With dynamic resolution enabled the target drops to half size, two world pixels per texel, while
+// frames run over budget and climbs back once they fit. Both scales are whole, so tiles keep even columns.
+#define VIEW_WIDTH 512
+#define VIEW_HEIGHT 288
+#define VIEW_LEVELS 2
+#define DYNAMIC_RESOLUTION false
+#define FRAME_BUDGET (1.0f / 60)
+
+typedef struct View {
+    RenderTexture2D levels[VIEW_LEVELS];
+    int level;
+    bool dynamic;
+    float over_budget;
+    float within_budget;
+} View;
+
+void view_init(View *view, bool dynamic) {
+    for (int i = 0; i < VIEW_LEVELS; i++) {
+        int w = VIEW_WIDTH >> i;
+        int h = VIEW_HEIGHT >> i;
+        view->levels[i] = LoadRenderTexture(w, h);
+        SetTextureFilter(view->levels[i].texture, TEXTURE_FILTER_POINT);
+    }
+    view->level = 0;
+    view->dynamic = dynamic;
+    view->over_budget = 0;
+    view->within_budget = 0;
+}
+
+RenderTexture2D view_target(View *view) {
+    return view->levels[view->level];
+}
+
+// Centers the current target on the camera target, snapped to whole target pixels. The window zoom of `cam` does not
+// apply, the target always shows VIEW_WIDTH x VIEW_HEIGHT world pixels.
+Camera2D view_camera(View *view, Camera2D cam) {
+    RenderTexture2D target = view_target(view);
+    Camera2D out = cam;
+    out.offset = (Vector2){target.texture.width / 2, target.texture.height / 2};
+    out.zoom = 1.0f / (1 << view->level);
+    out.target.x = floorf(cam.target.x * out.zoom) / out.zoom;
+    out.target.y = floorf(cam.target.y * out.zoom) / out.zoom;
+    return out;
+}
+
+void view_adapt(View *view, float dt) {
+    if (!view->dynamic) {
+        view->level = 0;
+        return;
+    }
+    if (dt > FRAME_BUDGET * 1.2f) {
+        view->over_budget += dt;
+        view->within_budget = 0;
+    } else {
+        view->within_budget += dt;
+        view->over_budget = 0;
+    }
+    if (view->over_budget > 0.5f && view->level < VIEW_LEVELS - 1) {
+        view->level++;
+        view->over_budget = 0;
+    } else if (view->within_budget > 3.0f && view->level > 0) {
+        view->level--;
+        view->within_budget = 0;
+    }
+}
+
+// Draws the target at the largest integer multiple of the base resolution that fits the window. Reduced levels are
+// stretched into the same rectangle so the picture does not change size.
+void view_present(View *view) {
+    Texture2D tex = view_target(view).texture;
+    float scale = fminf(GetScreenWidth() / VIEW_WIDTH, GetScreenHeight() / VIEW_HEIGHT);
+    if (scale < 1) {
+        scale = fminf((float)GetScreenWidth() / VIEW_WIDTH, (float)GetScreenHeight() / VIEW_HEIGHT);
+    }
+    float w = VIEW_WIDTH * scale;
+    float h = VIEW_HEIGHT * scale;
+    Rectangle dest = {(GetScreenWidth() - w) / 2, (GetScreenHeight() - h) / 2, w, h};
+    DrawTexturePro(tex, (Rectangle){0, 0, tex.width, -tex.height}, dest, (Vector2){0, 0}, 0, WHITE);
+}
+Rectangle camera_view_rect(Camera2D cam, float width, float height) {
+    return (Rectangle){
+        cam.target.x - cam.offset.x / cam.zoom,
+        cam.target.y - cam.offset.y / cam.zoom,
+        width / cam.zoom,
+        height / cam.zoom,
+    };
+}
+// ;view
+
+// :bg
+// The sky gradient is clipped to the visible span so it costs one quad no matter how tall the tower is. Parallax
+// layers are scattered tiles rendered once per chunk into a small LRU cache of render textures, one texel per world
+// pixel like the view, and drawn at whole target pixels so they stay as crisp as the level.
+#define MAX_BG_LAYERS 2
+#define BG_CHUNK_SIZE 256
+#define BG_CACHE_SIZE 16
+
+// `offset` and `chunk_base` carry what origin rebases took out of the camera, so the layer does not jump.
+typedef struct BgLayer {
+    float factor;
+    Color tint;
+    int density;
+    float offset;
+    int chunk_base;
+} BgLayer;
+
+typedef struct BgChunk {
+    RenderTexture2D tex;
+    int layer;
+    int cx;
+    int cy;
+    uint32_t last_used;
+    bool used;
+} BgChunk;
+
+typedef struct Background {
+    TextureID tileset;
+    float top;
+    float bottom;
+    Color top_color;
+    Color bottom_color;
+    int layer_cnt;
+    BgLayer layers[MAX_BG_LAYERS];
+    BgChunk chunks[BG_CACHE_SIZE];
+    uint32_t frame;
+} Background;
+
+uint32_t hash3(int a, int b, int c) {
+    uint32_t h = (uint32_t)a * 0x8da6b343u ^ (uint32_t)b * 0xd8163841u ^ (uint32_t)c * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+Color color_lerp(Color a, Color b, float t) {
+    return (Color){
+        Lerp(a.r, b.r, t),
+        Lerp(a.g, b.g, t),
+        Lerp(a.b, b.b, t),
+        Lerp(a.a, b.a, t),
+    };
+}
+
+void bg_init(Background *bg, TextureID tileset, Color top_color, Color bottom_color) {
+    bg->tileset = tileset;
+    bg->top_color = top_color;
+    bg->bottom_color = bottom_color;
+    bg->layer_cnt = 0;
+    bg->frame = 0;
+    for (int i = 0; i < BG_CACHE_SIZE; i++) {
+        bg->chunks[i].tex = LoadRenderTexture(BG_CHUNK_SIZE, BG_CHUNK_SIZE);
+        bg->chunks[i].used = false;
+    }
+}
+
+void bg_add_layer(Background *bg, float factor, Color tint, int density) {
+    bg->layers[bg->layer_cnt++] = (BgLayer){.factor = factor, .tint = tint, .density = density};
+}
+
+void bg_set_span(Background *bg, float top, float bottom) {
+    bg->top = top;
+    bg->bottom = bottom;
+}
+
+// Rounded to whole pixels of a target drawn with `cam`.
+Vector2 bg_layer_shift(BgLayer *layer, Camera2D cam) {
+    float x = cam.target.x * (1 - layer->factor);
+    float y = cam.target.y * (1 - layer->factor) + layer->offset;
+    return (Vector2){roundf(x * cam.zoom) / cam.zoom, roundf(y * cam.zoom) / cam.zoom};
+}
+
+// The layer moves by `factor` of the camera, whole chunks of that go to `chunk_base` to keep `offset` small.
+void bg_rebase(Background *bg, float dy) {
+    bg->top -= dy;
+    bg->bottom -= dy;
+    for (int l = 0; l < bg->layer_cnt; l++) {
+        BgLayer *layer = &bg->layers[l];
+        layer->offset -= layer->factor * dy;
+        int n = floorf(layer->offset / BG_CHUNK_SIZE);
+        layer->offset -= n * BG_CHUNK_SIZE;
+        layer->chunk_base -= n;
+    }
+}
+
+BgChunk *bg_find(Background *bg, int layer, int cx, int cy) {
+    for (int i = 0; i < BG_CACHE_SIZE; i++) {
+        BgChunk *c = &bg->chunks[i];
+        if (c->used && c->layer == layer && c->cx == cx && c->cy == cy) {
+            c->last_used = bg->frame;
+            return c;
+        }
+    }
+    return NULL;
+}
+
+void bg_render_chunk(Background *bg, int layer, int cx, int cy) {
+    BgChunk *lru = NULL;
+    for (int i = 0; i < BG_CACHE_SIZE; i++) {
+        BgChunk *c = &bg->chunks[i];
+        if (!c->used) {
+            lru = c;
+            break;
+        }
+        if (c->last_used != bg->frame && (!lru || c->last_used < lru->last_used)) {
+            lru = c;
+        }
+    }
+    if (!lru) {
+        return;
+    }
+    *lru = (BgChunk){lru->tex, layer, cx, cy, bg->frame, true};
+
+    BgLayer *l = &bg->layers[layer];
+    const int tiles = BG_CHUNK_SIZE / 16;
+    BeginTextureMode(lru->tex);
+    {
+        ClearBackground(BLANK);
+        for (int ty = 0; ty < tiles; ty++) {
+            for (int tx = 0; tx < tiles; tx++) {
+                uint32_t h = hash3(layer, cx * tiles + tx, cy * tiles + ty);
+                if (h % l->density != 0) {
+                    continue;
+                }
+                Rectangle src = {(2 + (h >> 8) % 4) * 16, 3 * 16, 16, 16};
+                Rectangle dst = {tx * 16, ty * 16, 16, 16};
+                DrawTexturePro(get_tex(bg->tileset), src, dst, (Vector2){0, 0}, 0, l->tint);
+            }
+        }
+    }
+    EndTextureMode();
+}
+
+// Must run outside of any texture mode, renders the chunks that `bg_draw` is about to need.
+void bg_prepare(Background *bg, Camera2D cam, Rectangle visible) {
+    bg->frame++;
+    for (int l = 0; l < bg->layer_cnt; l++) {
+        Vector2 shift = bg_layer_shift(&bg->layers[l], cam);
+        int base = bg->layers[l].chunk_base;
+        int cx0 = floorf((visible.x - shift.x) / BG_CHUNK_SIZE);
+        int cx1 = floorf((visible.x + visible.width - shift.x) / BG_CHUNK_SIZE);
+        int cy0 = floorf((visible.y - shift.y) / BG_CHUNK_SIZE);
+        int cy1 = floorf((visible.y + visible.height - shift.y) / BG_CHUNK_SIZE);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                if (!bg_find(bg, l, cx, cy + base)) {
+                    bg_render_chunk(bg, l, cx, cy + base);
+                }
+            }
+        }
+    }
+}
+
+void bg_draw(Background *bg, Camera2D cam, Rectangle visible) {
+    float y0 = fmaxf(visible.y, bg->top);
+    float y1 = fminf(visible.y + visible.height, bg->bottom);
+    if (y1 > y0) {
+        float span = bg->bottom - bg->top;
+        Color c0 = color_lerp(bg->top_color, bg->bottom_color, (floorf(y0) - bg->top) / span);
+        Color c1 = color_lerp(bg->top_color, bg->bottom_color, (ceilf(y1) - bg->top) / span);
+        DrawRectangleGradientV(floorf(visible.x), floorf(y0), ceilf(visible.width) + 1, ceilf(y1) - floorf(y0), c0, c1);
+    }
+
+    for (int l = 0; l < bg->layer_cnt; l++) {
+        Vector2 shift = bg_layer_shift(&bg->layers[l], cam);
+        int base = bg->layers[l].chunk_base;
+        int cx0 = floorf((visible.x - shift.x) / BG_CHUNK_SIZE);
+        int cx1 = floorf((visible.x + visible.width - shift.x) / BG_CHUNK_SIZE);
+        int cy0 = floorf((visible.y - shift.y) / BG_CHUNK_SIZE);
+        int cy1 = floorf((visible.y + visible.height - shift.y) / BG_CHUNK_SIZE);
+        for (int cy = cy0; cy <= cy1; cy++) {
+            for (int cx = cx0; cx <= cx1; cx++) {
+                BgChunk *c = bg_find(bg, l, cx, cy + base);
+                if (!c) {
+                    continue;
+                }
+                Rectangle dst = {cx * BG_CHUNK_SIZE + shift.x, cy * BG_CHUNK_SIZE + shift.y, BG_CHUNK_SIZE, BG_CHUNK_SIZE};
+                DrawTexturePro(c->tex.texture, (Rectangle){0, 0, BG_CHUNK_SIZE, -BG_CHUNK_SIZE}, dst, (Vector2){0, 0}, 0, WHITE);
+            }
+        }
+    }
+}
+// ;bg
+
+Entity *player;
+Player *data;
+ClipID clip_walk;
+ClipID clip_idle;
+Camera2D cam;
+View view;
+Background background;
+Entity *dead_zone;
+Minimap minimap;
+bool inited;
+TextureID coffee;
+TextureID trophy;
+TextureID tileset;
+
+static const Archetype archetypes[EID_CNT] = {
+#define ARCH_ROW(id, emit, minimap, enter, update) [id] = {emit, minimap, enter, update},
+    ARCHETYPES(ARCH_ROW)
+#undef ARCH_ROW
+};
+
+// Random platforms are at most three tiles wide and placed at +-GEN_MAX_COL columns, all of them fit the tilemap.
+#define GEN_MAX_COL 12
+_Static_assert(-GEN_MAX_COL >= TILE_MIN_COL && GEN_MAX_COL + 3 <= TILE_MIN_COL + 64, "generated platforms fit the tilemap");
+
+void game_gen_level(Game *game, int top) {
+    // Platforms are tiles, so every y below is kept on the grid.
+    top = tile_of(top) * TILE_SIZE;
+    bg_set_span(&background, top, 2000);
+    game->broad.tiles.tex = tileset;
+    game_add_plat(game, 0, 0, PT_THREE_WIDE);
+    game_add_plat(game, -96, 0, PT_THREE_WIDE);
+    game_add_en(game, gen_pickup(-100, -16, EID_JUMP_COFFEE, coffee));
+    int y = top;
+    game_add_plat(game, 0, y - 96, PT_FINAL);
+    game_add_en(game, gen_pickup(38, y - 160, EID_TROPHY, trophy));
+    while (y < -100) {
+        int rnd = GetRandomValue(0, 2);
+        int rndX = GetRandomValue(-GEN_MAX_COL, GEN_MAX_COL) * TILE_SIZE;
+        game_add_plat(game, rndX, y, rnd);
+
+        if (y % 3 == 0) {
+            game_add_plat(game, -rndX, y, rnd);
+        } else if (y % 5 == 0) {
+            game_add_en(game, gen_pickup(rndX, y - 16, EID_JUMP_COFFEE, coffee));
+        } else if (y % 11 == 0) {
+            game_add_en(game, gen_pickup(rndX, y - 16, EID_CHECK_COFFEE, coffee));
+        } else if (y % 7 == 0) {
+            game_add_en(game, gen_mover(-rndX, y - 32, PT_TWO_WIDE, (Vector2){rndX < 0 ? -96 : 96, 0}, 4, tileset));
+        } else if (y % 13 == 0) {
+            game_add_en(game, gen_mover(-rndX, y, PT_THREE_WIDE, (Vector2){0, -48}, 3, tileset));
+        }
+#if defined(Debug) || defined(Bench)
+        // Test NPCs for the actor path, the shipping levels have none.
+        if (rnd != PT_ONE_WIDE && y % 17 == 0) {
+            game_add_en(game, gen_walker(rndX, y - 24, clip_walk));
+        }
+#endif
+        y += 16 * 4;
+    }
+}
+
+// :origin
+// World positions are floats relative to a movable origin. Once the player is more than ORIGIN_CHUNK away from it,
+// the origin moves by whole chunks and everything is shifted back towards zero, so positions, the camera lerp and the
+// sub-pixel remainders keep the precision they have at the bottom of the tower however high it goes. A chunk is a
+// multiple of the broadphase table and of the tile and background chunks: buckets, tile rows and parallax tiles keep
+// their contents and only their indices move. Shifting by a multiple of a power of two is exact for positions in range.
+#define ORIGIN_CHUNK 16384
+
+typedef struct Origin {
+    int64_t y;
+    uint32_t rebases;
+} Origin;
+
+static Origin origin = {0};
+
+float world_local_y(double y) {
+    return (float)(y - origin.y);
+}
+
+double world_abs_y(float y) {
+    return origin.y + (double)y;
+}
+
+void en_rebase(Entity *e, float dy) {
+    e->pos.y -= dy;
+    e->aabb.y -= dy;
+    e->respawn.y -= dy;
+    e->broad_lo -= (int32_t)dy / BROAD_ROW;
+    e->broad_hi -= (int32_t)dy / BROAD_ROW;
+    if (e->contacts) {
+        e->contacts->area.y -= dy;
+        e->contacts->lo -= (int32_t)dy / BROAD_ROW;
+        e->contacts->hi -= (int32_t)dy / BROAD_ROW;
+    }
+    if (e->id == EID_MOVING_PLAT) {
+        ((Mover *)e->user_data)->origin.y -= dy;
+    }
+}
+
+// Moves the origin up by `dy`, a multiple of ORIGIN_CHUNK. One pass over the level, which happens every ORIGIN_CHUNK
+// pixels of climbing at most.
+void world_rebase(float dy) {
+    for (size_t i = 0; i < game.en_cnt; i++) {
+        en_rebase(game.ens[i], dy);
+    }
+    if (player) {
+        en_rebase(player, dy);
+    }
+    tilemap_rebase(&game.broad.tiles, dy);
+    game.cut_y -= dy;
+    for (int32_t i = 0; i < events.cnt; i++) {
+        events.items[i].pos.y -= dy;
+    }
+    for (int32_t i = 0; i < particles.cnt; i++) {
+        particles.y[i] -= dy;
+    }
+    cam.target.y -= dy;
+    bg_rebase(&background, dy);
+    minimap.statics_area.y -= dy;
+    origin.y += (int64_t)dy;
+    origin.rebases++;
+}
+
+// Call once per frame with the player's position.
+void origin_follow(float y) {
+    if (fabsf(y) > ORIGIN_CHUNK) {
+        world_rebase(truncf(y / ORIGIN_CHUNK) * ORIGIN_CHUNK);
+    }
+}
+// ;origin
+
+// :ui
+// Menu screens are retained: buttons are laid out once per screen (and again on resize) and everything is rendered
+// into a cache that is only redrawn when the hovered button or the screen changes. Only one screen is shown at a time,
+// so all of them share one window-sized target.
+#define MAX_UI_BTNS 4
+#define UI_VIEW_CNT (S_HOWTO + 1)
+
+typedef struct UiButton {
+    Rectangle rect;
+    const char *text;
+    Vector2 text_pos;
+} UiButton;
+
+typedef struct UiView {
+    bool laid_out;
+    bool dirty;
+    int hot;
+    int btn_cnt;
+    UiButton btns[MAX_UI_BTNS];
+} UiView;
+
+static UiView ui_views[UI_VIEW_CNT];
+
+// `screen` is the view whose picture is in `target`, -1 for none.
+typedef struct UiCache {
+    RenderTexture2D target;
+    int screen;
+} UiCache;
+
+static UiCache ui_cache = {.screen = -1};
+
+void ui_add_btn(UiView *v, Rectangle rect, const char *text) {
+    UiButton *b = &v->btns[v->btn_cnt++];
+    b->rect = rect;
+    b->text = text;
+    b->text_pos = (Vector2){rect.x + (rect.width / 2) - (MeasureText(text, 20) / 2), (rect.y + rect.height / 2) - 10};
+}
+
+void ui_invalidate(Screen screen) {
+    ui_views[screen].laid_out = false;
+}
+
+void ui_layout(UiView *v, Screen screen) {
+    v->btn_cnt = 0;
+    v->hot = -1;
+    Vector2 xyMid = (Vector2){GetScreenWidth() / 2, GetScreenHeight() / 2};
+    switch (screen) {
+    case S_MENU: {
+        Rectangle play = (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y, GetScreenWidth() * .2, 45};
+        ui_add_btn(v, play, "START GAME");
+        Rectangle credits = (Rectangle){play.x, play.y + play.height + 10, play.width, play.height};
+        ui_add_btn(v, credits, "CREDITS");
+        Rectangle how_to_play = (Rectangle){credits.x, credits.y + credits.height + 10, credits.width, credits.height};
+        ui_add_btn(v, how_to_play, "HOW TO");
+    } break;
+    case S_DIFFICULTY:
+        if (!inited) {
+            ui_add_btn(v, (Rectangle){xyMid.x - 200, xyMid.y, 400, 35}, "Continue");
+        } else {
+            ui_add_btn(v, (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y, GetScreenWidth() * .2, 45}, "Easy");
+            ui_add_btn(v, (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y + 55, GetScreenWidth() * .2, 45}, "Medium");
+            ui_add_btn(v, (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y + 110, GetScreenWidth() * .2, 45}, "Hard");
         }
+        break;
+    default:
+        break;
     }
 
-    ActorMoveX(collidables, collidables_len, player, player->vel.x, onCollide);
-    player->vel.y = Approach(player->vel.y, 3.6, 13 * GetFrameTime());
-    ActorMoveY(collidables, collidables_len, player, player->vel.y, onCollide);
-
-    update_anim(data->animation, GetFrameTime());
-
-    if (data->jump_boost_time > 0) {
-        data->jump_boost_time -= GetFrameTime();
-    } else if (data->jump_boost_time <= 0 && data->jump_power == -10) {
-        data->jump_power /= 2;
+    if (ui_cache.target.texture.width != GetScreenWidth() || ui_cache.target.texture.height != GetScreenHeight()) {
+        if (ui_cache.target.id != 0) {
+            UnloadRenderTexture(ui_cache.target);
+        }
+        ui_cache.target = LoadRenderTexture(GetScreenWidth(), GetScreenHeight());
+        ui_cache.screen = -1;
     }
-}
-// ;player
-
-Entity *en_collidable(float x, float y, float w, float h) {
-    Entity *e = arena_alloc(&arena, sizeof(Entity));
-    memset(e, 0, sizeof(Entity));
-    e->is_collidable = true;
-    en_setup(e, x, y, w, h);
-    en_add_props(e, EP_COLLIDABLE);
-    return e;
+    v->laid_out = true;
+    v->dirty = true;
 }
 
-void en_move_y(Entity *en, float y) {
-    en->pos.y = y;
-    en->aabb.y = y;
+void draw_esc_hint(void) {
+    DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
+    DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
+    DrawText("ESC", 12, 12, 10, BLACK);
 }
 
-void game_add_en(Game *game, Entity *e) {
-    game->ens[game->en_cnt++] = e;
+void ui_draw_text_block(const char *text, bool alternate) {
+    int cnt = 0;
+    const char **splited = TextSplit(text, '\n', &cnt);
+    int y = GetScreenHeight() / 2 - cnt * 20;
+    for (int i = 0; i < cnt; i++) {
+        Color color = WHITE;
+        if (alternate && i % 2 == 0) {
+            color = RED;
+        }
+        int size = MeasureText(splited[i], 20);
+        DrawText(splited[i], (GetScreenWidth() - size) * 0.5, y + i * 20, 20, color);
+    }
 }
 
-typedef enum PlatType {
-    PT_ONE_WIDE,
-    PT_TWO_WIDE,
-    PT_THREE_WIDE,
-    PT_FINAL = 5,
-} PlatType;
+void ui_render_static(Screen screen) {
+    switch (screen) {
+    case S_HOWTO:
+        ui_draw_text_block("Controls:\n"
+                           "A : Move left | D : Move right | Space : Jump\n"
+                           "Objective:\n"
+                           "Keep jumping until you get the gold trophy!\n"
+                           "\n"
+                           "Rules:\n"
+                           "Keep getting coffee (white cups) to increase the jump boost timer.\n"
+                           "If the jum boost bar runs out and you hit the dead zone the game ends.\n"
+                           "Green cups replaces the respawn point and moves the dead zone to it.",
+                           false);
+        draw_esc_hint();
+        break;
+    case S_DIFFICULTY: {
+        if (!inited) {
+            Vector2 xyMid = (Vector2){GetScreenWidth() / 2 - 140, GetScreenHeight() / 2 - 200};
+            DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2, 35, 35}, .2, 10, BEIGE);
+            DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y, 35, 35}, .2, 10, WHITE);
+            DrawText("A", xyMid.x + 2, (xyMid.y) + 2, 10, BLACK);
+            DrawText("Move left", (xyMid.x) + 2 + 45, (xyMid.y) + 2, 10, RAYWHITE);
+            DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2 + 45, 35, 35}, .2, 10, BEIGE);
+            DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y + 45, 35, 35}, .2, 10, WHITE);
+            DrawText("S", (xyMid.x) + 2, (xyMid.y) + 2 + 45, 10, BLACK);
+            DrawText("Move right", (xyMid.x) + 2 + 45, (xyMid.y) + 2 + 45, 10, RAYWHITE);
+            DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2 + 45 + 45, 85, 35}, .2, 10, BEIGE);
+            DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y + 45 + 45, 85, 35}, .2, 10, WHITE);
+            DrawText("SPACE", (xyMid.x) + 2, (xyMid.y) + 2 + 45 + 45, 10, BLACK);
+            DrawText("Jump", (xyMid.x) + 2 + 95, (xyMid.y) + 2 + 45 + 45, 10, RAYWHITE);
 
-Entity *gen_plat(float x, float y, PlatType type, TextureID texId) {
-    Entity *e = arena_alloc(&arena, sizeof(Entity));
-    memset(e, 0, sizeof(Entity));
-    switch (type) {
-    case PT_ONE_WIDE:
-        en_setup(e, x, y, 16, 16);
+            DrawTexture(get_tex(coffee), (xyMid.x) + 2 + 95 + 45, (xyMid.y), WHITE);
+            DrawText("+ jump boost", (xyMid.x) + 2 + 95 + 45 + 16 + 10, (xyMid.y) + 4, 10, RAYWHITE);
+            DrawTexture(get_tex(coffee), (xyMid.x) + 2 + 95 + 45, (xyMid.y) + 45, GREEN);
+            DrawText("checkpoint", (xyMid.x) + 2 + 95 + 45 + 16 + 10, (xyMid.y) + 4 + 45, 10, RAYWHITE);
+            DrawTexture(get_tex(trophy), (xyMid.x) + 2 + 95 + 45, (xyMid.y) + 45 + 45, WHITE);
+            DrawText("final objective", (xyMid.x) + 2 + 95 + 45 + 16 + 10 + 10, (xyMid.y) + 4 + 45 + 45, 10, RAYWHITE);
+        }
+        draw_esc_hint();
+    } break;
+    case S_LOST:
+        draw_esc_hint();
         break;
-    case PT_TWO_WIDE:
-        en_setup(e, x, y, 16 * 2, 16);
+    case S_WON:
+        DrawText("WON!", GetScreenWidth() / 2, GetScreenHeight() / 2, 30, WHITE);
+        draw_esc_hint();
         break;
-    case PT_THREE_WIDE:
-        en_setup(e, x, y, 16 * 3, 16);
+    case S_CREDITS:
+        ui_draw_text_block("Tileset: \n"
+                           "https://essssam.itch.io/rocky-roads\n"
+                           "Character: \n"
+                           "https://free-game-assets.itch.io/villagers-sprite-sheets-free-pixel-art-pack\n"
+                           "Cup of Coffe: \n"
+                           "https://skalding.itch.io/coffee-cup-001\n"
+                           "Trophies:\n"
+                           "https://buddy-games.itch.io/trophies-sprites\n"
+                           "Land, Jump Sounds:\n"
+                           "https://opengameart.org/content/12-player-movement-sfx\n",
+                           true);
+        draw_esc_hint();
         break;
-    case PT_FINAL:
-        en_setup(e, x, y, 16 * 6, 16 * 3);
+    default:
         break;
     }
-    en_add_props(e, EP_COLLIDABLE);
-    en_add_props(e, EP_PLAT);
-    e->id = EID_PLAT;
-    e->texId = texId;
-    e->is_collidable = true;
-    return e;
 }
 
-void plat_render(Entity *self) {
-    PlatType type = (self->aabb.width / 16) - 1;
-    switch (type) {
-    case PT_ONE_WIDE:
-        DrawTextureRec(get_tex(self->texId), (Rectangle){8 * 16, 16, 16, 16}, (Vector2){self->pos.x, self->pos.y}, WHITE);
-        break;
-    case PT_TWO_WIDE:
-        DrawTextureRec(get_tex(self->texId), (Rectangle){8 * 16, 16 * 3, 16, 16}, (Vector2){self->pos.x, self->pos.y}, WHITE);
-        DrawTextureRec(get_tex(self->texId), (Rectangle){10 * 16, 16 * 3, 16, 16}, (Vector2){self->pos.x + 16, self->pos.y}, WHITE);
-        break;
-    case PT_THREE_WIDE:
-        DrawTextureRec(get_tex(self->texId), (Rectangle){8 * 16, 16 * 3, 16, 16}, (Vector2){self->pos.x, self->pos.y}, WHITE);
-        DrawTextureRec(get_tex(self->texId), (Rectangle){9 * 16, 16 * 3, 16, 16}, (Vector2){self->pos.x + 16, self->pos.y}, WHITE);
-        DrawTextureRec(get_tex(self->texId), (Rectangle){10 * 16, 16 * 3, 16, 16}, (Vector2){self->pos.x + 32, self->pos.y}, WHITE);
-        break;
-    case PT_FINAL:
-        for (int x = 0; x < 6; x++) {
-            for (int y = 0; y < 3; y++) {
-                DrawTextureRec(get_tex(self->texId), (Rectangle){(1 + x) * 16, (2 + y) * 16, 16, 16}, (Vector2){self->pos.x + (x * 16), self->pos.y + (y * 16)}, WHITE);
-            }
+// Returns the index of the clicked button or -1.
+int ui_update(Screen screen) {
+    UiView *v = &ui_views[screen];
+    if (!v->laid_out || IsWindowResized()) {
+        ui_layout(v, screen);
+    }
+
+    int hot = -1;
+    for (int i = 0; i < v->btn_cnt; i++) {
+        if (CheckCollisionPointRec(GetMousePosition(), v->btns[i].rect)) {
+            hot = i;
         }
     }
+    if (hot != v->hot) {
+        v->hot = hot;
+        v->dirty = true;
+    }
+    if (hot >= 0 && IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
+        return hot;
+    }
+    return -1;
 }
-Entity *gen_pickup(float x, float y, EntityId id) {
-    Entity *e = arena_alloc(&arena, sizeof(Entity));
-    memset(e, 0, sizeof(Entity));
-    en_setup(e, x, y, 16, 16);
-    e->id = id;
-    en_add_props(e, EP_COLLIDABLE);
-    return e;
-}
-bool btn(Rectangle play, const char *text) {
-    bool clicked = false;
-    Color color = WHITE;
-    Color textColor = BLACK;
-    if (CheckCollisionPointRec(GetMousePosition(), play)) {
-        color = BLUE;
-        textColor = WHITE;
-        if (IsMouseButtonPressed(MOUSE_BUTTON_LEFT)) {
-            clicked = true;
+
+void ui_draw(Screen screen) {
+    UiView *v = &ui_views[screen];
+    if (!v->laid_out) {
+        ui_layout(v, screen);
+    }
+    if (v->dirty || ui_cache.screen != (int)screen) {
+        BeginTextureMode(ui_cache.target);
+        {
+            ClearBackground(BLACK);
+            ui_render_static(screen);
+            for (int i = 0; i < v->btn_cnt; i++) {
+                UiButton *b = &v->btns[i];
+                bool is_hot = i == v->hot;
+                DrawRectangleRounded(b->rect, .2, 10, is_hot ? BLUE : WHITE);
+                DrawText(b->text, b->text_pos.x, b->text_pos.y, 20, is_hot ? WHITE : BLACK);
+            }
         }
+        EndTextureMode();
+        v->dirty = false;
+        ui_cache.screen = screen;
     }
-    DrawRectangleRounded(play, .2, 10, color);
-    DrawText(text, play.x + (play.width / 2) - (MeasureText(text, 20) / 2), (play.y + play.height / 2) - 10, 20, textColor);
-    return clicked;
+    Texture2D tex = ui_cache.target.texture;
+    DrawTextureRec(tex, (Rectangle){0, 0, tex.width, -tex.height}, (Vector2){0, 0}, WHITE);
 }
-
-Entity *player;
-Player *data;
-Animation walk;
-Animation idle;
-Camera2D cam;
-Camera2D minimapCam;
-Entity *dead_zone;
-RenderTexture2D minimap;
-bool inited;
-TextureID coffee;
-TextureID trophy;
-TextureID tileset;
-TextureID boyWalk;
-TextureID boyIdle;
-int diff;
+// ;ui
 
 void UpdateDrawFrame() {
+    music_update(&music);
+#ifdef Debug
+    if (game.screen != S_LOADING) {
+        assets_hot_reload(&assets, GetFrameTime());
+    }
+#endif
     switch (game.screen) {
+    case S_LOADING:
+        if (loader_update(&loader)) {
+            lowlat_set_enabled(&lowlat, AUDIO_LOW_LATENCY);
+            music_open(&music, MUSIC_PATH, true);
+            game.screen = S_MENU;
+        }
+        break;
     case S_HOWTO:
-    case S_DIFFICULTY:
     case S_LOST:
     case S_WON:
     case S_CREDITS:
+        ui_update(game.screen);
         if (IsKeyPressed(KEY_ESCAPE)) {
             game.screen = S_MENU;
         }
         break;
+    case S_DIFFICULTY: {
+        int clicked = ui_update(S_DIFFICULTY);
+        if (IsKeyPressed(KEY_ESCAPE)) {
+            game.screen = S_MENU;
+        } else if (!inited && clicked == 0) {
+            inited = true;
+            ui_invalidate(S_DIFFICULTY);
+        } else if (inited && clicked >= 0) {
+            const int tops[] = {-2000, -5000, -10000};
+            game_gen_level(&game, tops[clicked]);
+            game.screen = S_GAME;
+        }
+    } break;
     case S_MENU:
+        switch (ui_update(S_MENU)) {
+        case 0:
+            game.screen = S_DIFFICULTY;
+            break;
+        case 1:
+            game.screen = S_CREDITS;
+            break;
+        case 2:
+            game.screen = S_HOWTO;
+            break;
+        default:
+            break;
+        }
         break;
     case S_GAME: {
 #ifdef Debug
         if (IsKeyPressed(KEY_C)) {
-            data->jump_boost_time = 20;
+            player_set_boost(data, JUMP_BOOST_MAX);
+        } else if (IsKeyPressed(KEY_R)) {
+            view.dynamic = !view.dynamic;
+        } else if (IsKeyPressed(KEY_L)) {
+            lowlat_set_enabled(&lowlat, !lowlat.enabled);
         } else if (IsKeyPressed(KEY_K)) {
-            en_move_y(player, -10300);
+            en_move_y(player, world_local_y(-10300));
             cam.target = player->pos;
         }
 #endif
@@ -494,59 +4403,27 @@ void UpdateDrawFrame() {
             game.screen = S_MENU;
         }
 
-        player_update(player, &walk, &idle);
+        timers_advance(&timers, frame_time());
+        activity_update(&activity, &game, camera_view_rect(cam, GetScreenWidth(), GetScreenHeight()), dead_zone->pos.y, data->actor);
+        arch_update_runs(&game, activity.ens, activity.cnt, frame_time());
+        player_update(player, clip_walk, clip_idle);
+        actors_update(&actors, &game.broad, activity.actors, activity.actor_cnt, frame_time());
+        game_events_flush(&events);
+        anim_update(&animator, frame_time());
+        particles_update(&particles, frame_time());
 
-        cam.target = Vector2Lerp(cam.target, player->pos, fabsf(player->vel.y) * GetFrameTime());
+        cam.target = Vector2Lerp(cam.target, player->pos, fabsf(player->vel.y) * frame_time());
 
-        float zoom = Clamp(cam.zoom - floorf(-player->vel.y) * 100 / 100, 1.0, 2.0);
-        cam.zoom = Lerp(cam.zoom, zoom, 1 * GetFrameTime());
         en_move_y(dead_zone, player->respawn.y + player->aabb.height + 32);
-        minimapCam = cam;
-
-        for (int i = 0; i < game.en_cnt; i++) {
-            Entity *en = game.ens[i];
-            if (en->pos.y > dead_zone->pos.y) {
-                en->is_valid = false;
-            }
-            if (!en->is_valid) {
-                continue;
-            }
-            if (en->id == EID_TROPHY) {
-                en_move_y(en, en->pos.y - sinf(GetTime() * 3));
-            }
+        if (tilemap_cut(&game.broad.tiles, dead_zone->pos.y)) {
+            game.en_rev++;
         }
+        game_cut_below(&game, dead_zone->pos.y);
+        origin_follow(player->pos.y);
 
-        BeginTextureMode(minimap);
-        {
-            ClearBackground(BLANK);
-            minimapCam.zoom = 1;
-            BeginMode2D(minimapCam);
-            {
-                for (int i = 0; i < game.en_cnt; i++) {
-                    Entity *en = game.ens[i];
-
-                    if (!en->is_valid) {
-                        continue;
-                    }
-                    switch (en->id) {
-                    case EID_PLAT:
-                        plat_render(en);
-                        break;
-                    case EID_JUMP_COFFEE:
-                        DrawRectangleRec(en->aabb, WHITE);
-                        break;
-                    case EID_CHECK_COFFEE:
-                        DrawRectangleRec(en->aabb, GREEN);
-                        break;
-                    default:
-                        break;
-                    }
-                }
-                DrawRectangleRec(player->aabb, RED);
-            }
-            EndMode2D();
-        }
-        EndTextureMode();
+        sfx_flush(&sfx_bank);
+        minimap_update(&minimap, &game, player, cam.target, frame_time());
+        view_adapt(&view, GetFrameTime());
     } break;
     default:
         break;
@@ -556,179 +4433,43 @@ void UpdateDrawFrame() {
     {
 
         switch (game.screen) {
-        case S_HOWTO:
-            const char *howtoText = "Controls:\n"
-                                    "A : Move left | D : Move right | Space : Jump\n"
-                                    "Objective:\n"
-                                    "Keep jumping until you get the gold trophy!\n"
-                                    "\n"
-                                    "Rules:\n"
-                                    "Keep getting coffee (white cups) to increase the jump boost timer.\n"
-                                    "If the jum boost bar runs out and you hit the dead zone the game ends.\n"
-                                    "Green cups replaces the respawn point and moves the dead zone to it.";
+        case S_LOADING: {
             ClearBackground(BLACK);
-            int cnt = 0;
-            const char **splited = TextSplit(howtoText, '\n', &cnt);
-            float y = GetScreenHeight() / 2 - cnt * 20;
-            for (int i = 0; i < cnt; i++) {
-                Color color = WHITE;
-                float size = MeasureText(splited[i], 20);
-                DrawText(splited[i], ((GetScreenWidth() - size)) * 0.5, y + i * 20, 20, color);
-            }
-
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
-            break;
-        case S_DIFFICULTY: {
-            ClearBackground(BLACK);
-
-            Vector2 xyMid = (Vector2){GetScreenWidth() / 2, GetScreenHeight() / 2};
-
-            if (!inited) {
-                xyMid.x -= 140;
-                xyMid.y -= 200;
-                DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2, 35, 35}, .2, 10, BEIGE);
-                DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y, 35, 35}, .2, 10, WHITE);
-                DrawText("A", xyMid.x + 2, (xyMid.y) + 2, 10, BLACK);
-                DrawText("Move left", (xyMid.x) + 2 + 45, (xyMid.y) + 2, 10, RAYWHITE);
-                DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2 + 45, 35, 35}, .2, 10, BEIGE);
-                DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y + 45, 35, 35}, .2, 10, WHITE);
-                DrawText("S", (xyMid.x) + 2, (xyMid.y) + 2 + 45, 10, BLACK);
-                DrawText("Move right", (xyMid.x) + 2 + 45, (xyMid.y) + 2 + 45, 10, RAYWHITE);
-                DrawRectangleRounded((Rectangle){xyMid.x + 2, xyMid.y + 2 + 45 + 45, 85, 35}, .2, 10, BEIGE);
-                DrawRectangleRounded((Rectangle){xyMid.x, xyMid.y + 45 + 45, 85, 35}, .2, 10, WHITE);
-                DrawText("SPACE", (xyMid.x) + 2, (xyMid.y) + 2 + 45 + 45, 10, BLACK);
-                DrawText("Jump", (xyMid.x) + 2 + 95, (xyMid.y) + 2 + 45 + 45, 10, RAYWHITE);
-
-                DrawTexture(get_tex(coffee), (xyMid.x) + 2 + 95 + 45, (xyMid.y), WHITE);
-                DrawText("+ jump boost", (xyMid.x) + 2 + 95 + 45 + 16 + 10, (xyMid.y) + 4, 10, RAYWHITE);
-                DrawTexture(get_tex(coffee), (xyMid.x) + 2 + 95 + 45, (xyMid.y) + 45, GREEN);
-                DrawText("checkpoint", (xyMid.x) + 2 + 95 + 45 + 16 + 10, (xyMid.y) + 4 + 45, 10, RAYWHITE);
-                DrawTexture(get_tex(trophy), (xyMid.x) + 2 + 95 + 45, (xyMid.y) + 45 + 45, WHITE);
-                DrawText("final objective", (xyMid.x) + 2 + 95 + 45 + 16 + 10 + 10, (xyMid.y) + 4 + 45 + 45, 10, RAYWHITE);
-
-                xyMid.x += 140;
-                xyMid.y += 200;
-
-                Rectangle how_to_play = (Rectangle){xyMid.x - 200, xyMid.y, 400, 35};
-                if (btn(how_to_play, "Continue")) {
-                    inited = true;
-                    xyMid = (Vector2){GetScreenWidth() / 2, GetScreenHeight() / 2};
-                }
-            } else {
-
-                Rectangle easy = (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y, GetScreenWidth() * .2, 45};
-                if (btn(easy, "Easy")) {
-                    diff = -2000;
-                    game_add_en(&game, gen_plat(0, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_plat(-100, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_pickup(-100, -16, EID_JUMP_COFFEE));
-                    int y = -2000;
-                    game_add_en(&game, gen_plat(0, y - 100, PT_FINAL, tileset));
-                    game_add_en(&game, gen_pickup(38, y - 160, EID_TROPHY));
-                    while (y < -100) {
-                        int rnd = GetRandomValue(0, 2);
-                        int rndX = GetRandomValue(-200, 200);
-                        game_add_en(&game, gen_plat(rndX, y, rnd, tileset));
-
-                        if (y % 3 == 0) {
-                            game_add_en(&game, gen_plat(-rndX, y, rnd, tileset));
-                        } else if (y % 5 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_JUMP_COFFEE));
-                        } else if (y % 11 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_CHECK_COFFEE));
-                        }
-                        y += 16 * 4;
-                    }
-
-                    game.screen = S_GAME;
-                }
-                Rectangle medium = {xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y + 55, GetScreenWidth() * .2, 45};
-                if (btn(medium, "Medium")) {
-                    diff = -5000;
-                    game_add_en(&game, gen_plat(0, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_plat(-100, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_pickup(-100, -16, EID_JUMP_COFFEE));
-                    int y = -5000;
-                    game_add_en(&game, gen_plat(0, y - 100, PT_FINAL, tileset));
-                    game_add_en(&game, gen_pickup(38, y - 160, EID_TROPHY));
-                    while (y < -100) {
-                        int rnd = GetRandomValue(0, 2);
-                        int rndX = GetRandomValue(-200, 200);
-                        game_add_en(&game, gen_plat(rndX, y, rnd, tileset));
-
-                        if (y % 3 == 0) {
-                            game_add_en(&game, gen_plat(-rndX, y, rnd, tileset));
-                        } else if (y % 5 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_JUMP_COFFEE));
-                        } else if (y % 11 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_CHECK_COFFEE));
-                        }
-                        y += 16 * 4;
-                    }
-
-                    game.screen = S_GAME;
-                }
-                Rectangle hard = {xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y + 110, GetScreenWidth() * .2, 45};
-                if (btn(hard, "Hard")) {
-                    diff = -10000;
-                    game_add_en(&game, gen_plat(0, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_plat(-100, 0, PT_THREE_WIDE, tileset));
-                    game_add_en(&game, gen_pickup(-100, -16, EID_JUMP_COFFEE));
-                    int y = -10000;
-                    game_add_en(&game, gen_plat(0, y - 100, PT_FINAL, tileset));
-                    game_add_en(&game, gen_pickup(38, y - 160, EID_TROPHY));
-                    while (y < -100) {
-                        int rnd = GetRandomValue(0, 2);
-                        int rndX = GetRandomValue(-200, 200);
-                        game_add_en(&game, gen_plat(rndX, y, rnd, tileset));
-
-                        if (y % 3 == 0) {
-                            game_add_en(&game, gen_plat(-rndX, y, rnd, tileset));
-                        } else if (y % 5 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_JUMP_COFFEE));
-                        } else if (y % 11 == 0) {
-                            game_add_en(&game, gen_pickup(rndX, y - 16, EID_CHECK_COFFEE));
-                        }
-                        y += 16 * 4;
-                    }
-
-                    game.screen = S_GAME;
-                }
-            }
-
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
+            float w = GetScreenWidth() * .4;
+            Rectangle bar = {(GetScreenWidth() - w) / 2, GetScreenHeight() / 2, w, 20};
+            DrawText("Loading", bar.x, bar.y - 30, 20, WHITE);
+            DrawRectangleRec((Rectangle){bar.x, bar.y, bar.width * loader_progress(&loader), bar.height}, DARKBROWN);
+            DrawRectangleLinesEx(bar, 2, BROWN);
         } break;
+        case S_HOWTO:
+        case S_DIFFICULTY:
         case S_MENU:
-            ClearBackground(BLACK);
-            Vector2 xyMid = (Vector2){GetScreenWidth() / 2, GetScreenHeight() / 2};
-            Rectangle play = (Rectangle){xyMid.x - GetScreenWidth() * .2 / 2, xyMid.y, GetScreenWidth() * .2, 45};
-
-            if (btn(play, "START GAME")) {
-                game.screen = S_DIFFICULTY;
-            }
-            Rectangle credits = (Rectangle){play.x, play.y + play.height + 10, play.width, play.height};
-            if (btn(credits, "CREDITS")) {
-                game.screen = S_CREDITS;
-            }
-            Rectangle how_to_play = (Rectangle){credits.x, credits.y + credits.height + 10, credits.width, credits.height};
-            if (btn(how_to_play, "HOW TO")) {
-                game.screen = S_HOWTO;
-            }
+        case S_LOST:
+        case S_WON:
+        case S_CREDITS:
+            ui_draw(game.screen);
             break;
         case S_GAME: {
             ClearBackground(BLACK);
 
-            BeginMode2D(cam);
+            RenderTexture2D target = view_target(&view);
+            Camera2D world_cam = view_camera(&view, cam);
+            Rectangle visible = camera_view_rect(world_cam, target.texture.width, target.texture.height);
+            bg_prepare(&background, world_cam, visible);
+            // Sprites can hang over their aabb (the trophy is 24px on a 16px box).
+            Rectangle cull = {visible.x - 16, visible.y - 16, visible.width + 32, visible.height + 32};
+            visible_collect(&render_visible, &game.broad, cull);
+            render_cmds_build(&render_pool, render_visible.ens, render_visible.cnt);
+
+            BeginTextureMode(target);
+            ClearBackground(BLACK);
+            BeginMode2D(world_cam);
             {
-                DrawRectangleGradientV(-GetScreenWidth(), diff, GetScreenWidth() * 2, abs(diff) + 2000, BLACK, BLUE);
+                bg_draw(&background, world_cam, visible);
 
                 DrawTexturePro(
-                    get_tex(data->animation->tex),
-                    (Rectangle){data->animation->current_frame * 48, 0, player->flip ? -24 : 24, 48},
+                    get_tex(anim_tex(&animator, data->anim)),
+                    anim_frame(&animator, data->anim, player->flip),
                     (Rectangle){player->pos.x, player->pos.y - 24, 24, 48},
                     (Vector2){},
                     0,
@@ -738,50 +4479,34 @@ void UpdateDrawFrame() {
                 DrawRectangleLinesEx(player->aabb, 1.0, GREEN);
 #endif
 
-                for (int i = 0; i < game.en_cnt; i++) {
-                    Entity *en = game.ens[i];
-                    if (!en->is_valid) {
-                        continue;
-                    }
-                    switch (en->id) {
-                    case EID_PLAT:
-                        plat_render(en);
-                        break;
-                    case EID_JUMP_COFFEE:
-                        DrawTextureV(get_tex(coffee), en->pos, WHITE);
-                        break;
-                    case EID_CHECK_COFFEE:
-                        DrawTextureV(get_tex(coffee), en->pos, GREEN);
-                        break;
-                    case EID_TROPHY:
-                        DrawTextureV(get_tex(trophy), en->pos, WHITE);
-                        break;
-                    case EID_DEAD_ZONE:
-                        DrawRectangleV(en->pos, en->size, RED);
-                    default:
-                        break;
-                    }
+                tilemap_draw(&game.broad.tiles, visible);
+                render_cmds_submit(&render_pool);
+                particles_draw(&particles, visible);
+
 #ifdef Debug
-                    for (int i = 0; i < en->prop_cnt; i++) {
-                        EntityProp p = en->props[i];
-                        switch (p) {
-                        case EP_COLLIDABLE:
-                            DrawRectangleLinesEx(en->aabb, 1.0, RED);
-                            break;
-                        default:
-                            break;
-                        }
+                for (int32_t row = tile_of(visible.y); row <= tile_of(visible.y + visible.height); row++) {
+                    uint64_t bits = tilemap_row(&game.broad.tiles, row);
+                    for (; bits; bits &= bits - 1) {
+                        int32_t col = TILE_MIN_COL + __builtin_ctzll(bits);
+                        DrawRectangleLinesEx((Rectangle){col * TILE_SIZE, row * TILE_SIZE, TILE_SIZE, TILE_SIZE}, 1.0, RED);
                     }
-#endif
                 }
+                for (int32_t i = 0; i < render_visible.cnt; i++) {
+                    Entity *en = render_visible.ens[i];
+                    if (en_has_prop(en, EP_COLLIDABLE) || en_has_prop(en, EP_TRIGGER)) {
+                        DrawRectangleLinesEx(en->aabb, 1.0, en_has_prop(en, EP_TRIGGER) ? YELLOW : RED);
+                    }
+                }
+#endif
             }
             EndMode2D();
+            EndTextureMode();
+            view_present(&view);
 
-            const float MAX_JUMP_BOOST = 20;
             float yStart = GetScreenHeight() - 100;
             float xStart = (GetScreenWidth() - 400) * 0.5;
             DrawRectangleV((Vector2){xStart, yStart}, (Vector2){400, 25}, BROWN);
-            float current_width = 400 * data->jump_boost_time / MAX_JUMP_BOOST;
+            float current_width = 400 * timer_left(&timers, data->boost) / JUMP_BOOST_MAX;
             DrawRectangleV((Vector2){xStart, yStart}, (Vector2){current_width, 25}, DARKBROWN);
             DrawRectangleLinesEx((Rectangle){xStart, yStart, 400, 25}, 2, DARKBROWN);
             DrawText(
@@ -797,77 +4522,398 @@ void UpdateDrawFrame() {
                 GetFontDefault().baseSize * 2,
                 WHITE);
 
-            DrawTexturePro(
-                minimap.texture,
-                (Rectangle){0, 0, minimap.texture.width, -minimap.texture.height},
-                (Rectangle){10, GetScreenHeight() - GetScreenHeight() / 4 - 10, GetScreenWidth() / 4, GetScreenHeight() / 4},
-                (Vector2){},
-                0,
-                WHITE);
-            DrawRectangleLinesEx((Rectangle){10, GetScreenHeight() - GetScreenHeight() / 4 - 10, GetScreenWidth() / 4, GetScreenHeight() / 4}, 2.0, BLACK);
+            minimap_draw(&minimap, (Vector2){10, GetScreenHeight() - minimap.target.texture.height - 10});
 
             DrawFPS(10, 55);
+#ifdef Debug
+            unsigned long long lat_cnt = atomic_load(&latency.count);
+            DrawText(TextFormat("%s audio latency: %.1f ms avg, %.1f ms max, %.1f ms last (%llu)",
+                                lowlat.enabled ? "low latency" : "pooled",
+                                lat_cnt ? atomic_load(&latency.sum_us) / 1000.0 / lat_cnt : 0.0,
+                                atomic_load(&latency.max_us) / 1000.0,
+                                atomic_load(&latency.last_us) / 1000.0,
+                                lat_cnt),
+                     10, 80, 10, WHITE);
+            unsigned long long lookups = contact_stats.hits + contact_stats.misses;
+            DrawText(TextFormat("contact cache: %.1f%% hits", lookups ? 100.0 * contact_stats.hits / lookups : 0.0), 10, 92, 10, WHITE);
+            DrawText(TextFormat("active: %d entities, %d actors of %zu entities", activity.cnt, activity.actor_cnt, game.en_cnt), 10, 116, 10, WHITE);
+            DrawText(TextFormat("events: %llu jumped, %llu landed, %llu pickups, %llu deaths", events.totals[GE_JUMPED],
+                                events.totals[GE_LANDED], events.totals[GE_PICKUP], events.totals[GE_DIED]),
+                     10, 104, 10, WHITE);
+            DrawText(TextFormat("origin: %lld (%u rebases)", (long long)origin.y, origin.rebases), 10, 128, 10, WHITE);
+#endif
 
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
+            draw_esc_hint();
 
         } break;
-        case S_LOST:
-            ClearBackground(BLACK);
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
+        default:
             break;
-        case S_WON: {
-            ClearBackground(BLACK);
+        }
+    }
+    if (game.screen == S_GAME || game.screen == S_LOADING) {
+        DisableEventWaiting();
+    } else {
+        EnableEventWaiting();
+    }
+    EndDrawing();
+}
 
-            Vector2 xyMid = {GetScreenWidth() / 2, GetScreenHeight() / 2};
+#ifdef Bench
+// :bench
+// Headless measurements, built with `.\build.ps1 bench`. Every case prints the average cost of one simulated frame.
+#define BENCH_FRAMES 600
 
-            DrawText("WON!", xyMid.x, xyMid.y, 30, WHITE);
+void bench_spawn_walkers(Game *game, int32_t cnt) {
+    Tilemap *t = &game->broad.tiles;
+    for (int32_t k = 0; cnt > 0; k = (k + 1) % t->chunk_cnt) {
+        TileChunk *c = &t->chunks[k];
+        for (int32_t i = 0; i < c->plat_cnt && cnt > 0; i++) {
+            Rectangle r = static_plat_rect(t->chunk_lo + k, &c->plats[i]);
+            if (r.width >= 32 && r.height == TILE_SIZE) {
+                game_add_en(game, gen_walker(r.x + GetRandomValue(0, r.width - 18), r.y - 24, clip_walk));
+                cnt--;
+            }
+        }
+    }
+}
 
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
-        } break;
-        case S_CREDITS: {
-            const char *creditsText = "Tileset: \n"
-                                      "https://essssam.itch.io/rocky-roads\n"
-                                      "Character: \n"
-                                      "https://free-game-assets.itch.io/villagers-sprite-sheets-free-pixel-art-pack\n"
-                                      "Cup of Coffe: \n"
-                                      "https://skalding.itch.io/coffee-cup-001\n"
-                                      "Trophies:\n"
-                                      "https://buddy-games.itch.io/trophies-sprites\n"
-                                      "Land, Jump Sounds:\n"
-                                      "https://opengameart.org/content/12-player-movement-sfx\n";
-            ClearBackground(BLACK);
-            int cnt = 0;
-            const char **splited = TextSplit(creditsText, '\n', &cnt);
-            int y = GetScreenHeight() / 2 - cnt * 20;
-            for (int i = 0; i < cnt; i++) {
-                Color color = WHITE;
-                if (i % 2 == 0) {
-                    color = RED;
+#define BENCH_TILE_QUERIES 65536
+
+// Bytes the static platforms take as a tilemap against what the same platforms cost as entities: the Entity, its props,
+// its slot in `game.ens` and one bucket slot per broadphase row it covers.
+void bench_tiles(Tilemap *t) {
+    size_t plat_cnt = 0, as_tiles = t->chunk_cnt * sizeof(TileChunk), as_ens = 0;
+    for (int32_t k = 0; k < t->chunk_cnt; k++) {
+        TileChunk *c = &t->chunks[k];
+        as_tiles += c->plat_cap * sizeof(StaticPlat);
+        for (int32_t i = 0; i < c->plat_cnt; i++) {
+            Rectangle r = static_plat_rect(t->chunk_lo + k, &c->plats[i]);
+            as_ens += sizeof(Entity) + MAX_PROPS * sizeof(EntityProp) + sizeof(Entity *);
+            as_ens += (broad_row(r.y + r.height) - broad_row(r.y) + 1) * sizeof(Entity *);
+        }
+        plat_cnt += c->plat_cnt;
+    }
+    printf("tiles: %zu platforms  %zu bytes as entities (%.1f each)  %zu bytes as tiles (%.1f each)\n", plat_cnt, as_ens,
+           (double)as_ens / plat_cnt, as_tiles, (double)as_tiles / plat_cnt);
+
+    static Rectangle queries[BENCH_TILE_QUERIES];
+    for (int q = 0; q < BENCH_TILE_QUERIES; q++) {
+        queries[q] = (Rectangle){GetRandomValue(-256, 256), GetRandomValue(-10000, 0), 18, 24};
+    }
+    double start = GetTime();
+    long hits = 0;
+    for (int q = 0; q < BENCH_TILE_QUERIES; q++) {
+        hits += tilemap_solid(t, queries[q]);
+    }
+    printf("tiles: %.1f ns per box query (%ld hits)\n", (GetTime() - start) * 1e9 / BENCH_TILE_QUERIES, hits);
+}
+
+void bench_actors(void) {
+    static ActorID all[MAX_ACTORS];
+    for (ActorID i = 0; i < actors.cnt; i++) {
+        all[i] = i;
+    }
+    double start = GetTime();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        game_update_archetypes(&game, 1.0f / 60);
+        actors_update(&actors, &game.broad, all, actors.cnt, 1.0f / 60);
+    }
+    double us = (GetTime() - start) / BENCH_FRAMES * 1e6;
+    unsigned long long lookups = contact_stats.hits + contact_stats.misses;
+    printf("actors: %6d actors %9.1f us/frame %7.1f ns/actor  contact cache %4.1f%% hits\n", actors.cnt, us,
+           us * 1000 / actors.cnt, lookups ? 100.0 * contact_stats.hits / lookups : 0);
+    contact_stats = (ContactStats){0};
+}
+
+// The same level simulated only around a camera halfway up the tower, with the dead zone `gap` under the view. The
+// cost must not grow with the gap.
+void bench_activity(float gap) {
+    Rectangle view = {-256, -5000, 512, 288};
+    double start = GetTime();
+    for (int f = 0; f < BENCH_FRAMES; f++) {
+        activity_update(&activity, &game, view, view.y + view.height + gap, -1);
+        arch_update_runs(&game, activity.ens, activity.cnt, 1.0f / 60);
+        actors_update(&actors, &game.broad, activity.actors, activity.actor_cnt, 1.0f / 60);
+    }
+    double us = (GetTime() - start) / BENCH_FRAMES * 1e6;
+    printf("activity: dead zone %5.0f px under the view  %d of %zu entities awake, %d actors  %9.1f us/frame\n", gap,
+           activity.cnt, game.en_cnt, activity.actor_cnt, us);
+}
+
+// First hit of one box against `cnt` candidates: the old per-Entity CheckCollisionRecs loop, the scalar kernel and the
+// SIMD kernel over the same data. The hit indices must agree.
+#define BENCH_AABB_SETS 256
+#define BENCH_AABB_QUERIES 2048
+
+void bench_aabb(int32_t cnt) {
+    static AabbSet sets[BENCH_AABB_SETS];
+    static Entity *ens[BENCH_AABB_SETS][AABB_SET_CAP];
+    static Rectangle queries[BENCH_AABB_QUERIES];
+    for (int s = 0; s < BENCH_AABB_SETS; s++) {
+        sets[s].cnt = 0;
+        for (int32_t i = 0; i < cnt; i++) {
+            Entity *e = arena_alloc(&arena, sizeof(Entity));
+            memset(e, 0, sizeof(Entity));
+            en_setup(e, GetRandomValue(0, 1024), GetRandomValue(0, 1024), GetRandomValue(1, 3) * 16, 16);
+            ens[s][i] = e;
+            aabb_set_push(&sets[s], e->aabb);
+        }
+    }
+    for (int q = 0; q < BENCH_AABB_QUERIES; q++) {
+        queries[q] = (Rectangle){GetRandomValue(0, 1024), GetRandomValue(0, 1024), 18, 24};
+    }
+
+    long sums[3] = {0};
+    double times[3];
+    for (int k = 0; k < 3; k++) {
+        double start = GetTime();
+        for (int q = 0; q < BENCH_AABB_QUERIES; q++) {
+            for (int s = 0; s < BENCH_AABB_SETS; s++) {
+                int32_t hit = -1;
+                if (k == 0) {
+                    for (int32_t i = 0; i < cnt; i++) {
+                        if (CheckCollisionRecs(ens[s][i]->aabb, queries[q])) {
+                            hit = i;
+                            break;
+                        }
+                    }
+                } else if (k == 1) {
+                    hit = aabb_first_hit_scalar(&sets[s], 0, queries[q]);
+                } else {
+                    hit = aabb_first_hit(&sets[s], 0, queries[q]);
                 }
-                int size = MeasureText(splited[i], 20);
-                DrawText(splited[i], (GetScreenWidth() - size) * 0.5, y + i * 20, 20, color);
+                sums[k] += hit;
             }
+        }
+        times[k] = (GetTime() - start) * 1e9 / ((double)BENCH_AABB_QUERIES * BENCH_AABB_SETS);
+    }
+    printf("aabb: %2d boxes  recs %6.1f ns  scalar %6.1f ns  %d lanes %6.1f ns  %s\n", cnt, times[0], times[1], AABB_LANES,
+           times[2], sums[0] == sums[1] && sums[1] == sums[2] ? "ok" : "MISMATCH");
+}
 
-            DrawRectangleRounded((Rectangle){12, 12, 35, 35}, .2, 10, BEIGE);
-            DrawRectangleRounded((Rectangle){10, 10, 35, 35}, .2, 10, WHITE);
-            DrawText("ESC", 12, 12, 10, BLACK);
-        } break;
-        default:
-            break;
+// Box casts straight down against stepping the same box one pixel at a time, the contact points must agree. A box
+// that starts inside a solid hits at 0.
+#define BENCH_CASTS 4096
+
+void bench_casts(Broadphase *bp) {
+    static Rectangle boxes[BENCH_CASTS];
+    static Vector2 deltas[BENCH_CASTS];
+    static CastHit hits[BENCH_CASTS];
+    for (int i = 0; i < BENCH_CASTS; i++) {
+        boxes[i] = (Rectangle){GetRandomValue(-256, 256), GetRandomValue(-10000, 0), 18, 24};
+        deltas[i] = (Vector2){0, GetRandomValue(1, 256)};
+    }
+    QueryFilter solids = {EP_COLLIDABLE, true, NULL};
+    double start = GetTime();
+    world_boxcasts(bp, boxes, deltas, BENCH_CASTS, solids, hits);
+    double ns = (GetTime() - start) * 1e9 / BENCH_CASTS;
+
+    int bad = 0, hit_cnt = 0;
+    Entity *ens[QUERY_MAX_HITS];
+    for (int i = 0; i < BENCH_CASTS; i++) {
+        Rectangle b = boxes[i];
+        int stop = -1;
+        for (int k = 0; k <= deltas[i].y && stop < 0; k++) {
+            Rectangle at = {b.x, b.y + k, b.width, b.height};
+            if (tilemap_solid(&bp->tiles, at) || world_query(bp, at, solids, ens, QUERY_MAX_HITS) > 0) {
+                stop = k > 0 ? k - 1 : 0;
+            }
         }
+        hit_cnt += stop >= 0;
+        bad += (stop >= 0) != hits[i].hit || (stop >= 0 && fabsf(hits[i].point.y - (b.y + stop)) > 1e-3f);
     }
-    EndDrawing();
+    printf("query: %d box casts %6.1f ns each  %d hits  %s\n", BENCH_CASTS, ns, hit_cnt, bad ? "MISMATCH" : "ok");
+}
+
+// Schedules a full wheel of timers up to 10 minutes out, cancels every fourth and runs the clock until all fired. Each
+// timer must fire on its due tick and the cancelled ones never.
+typedef struct BenchTimer {
+    uint64_t due;
+    uint64_t fired;
+} BenchTimer;
+
+void bench_timer_fire(void *arg) {
+    ((BenchTimer *)arg)->fired = timers.tick;
+}
+
+void bench_timers(void) {
+    static BenchTimer bts[MAX_TIMERS];
+    static TimerID ids[MAX_TIMERS];
+    timers = (TimerWheel){0};
+    double start = GetTime();
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        int ticks = GetRandomValue(1, 600 * TIMER_HZ);
+        bts[i] = (BenchTimer){timers.tick + ticks, 0};
+        ids[i] = timer_after(&timers, (float)ticks / TIMER_HZ, bench_timer_fire, &bts[i]);
+    }
+    for (int i = 0; i < MAX_TIMERS; i += 4) {
+        timer_cancel(&timers, ids[i]);
+    }
+    double schedule_ns = (GetTime() - start) * 1e9 / MAX_TIMERS;
+    start = GetTime();
+    int ticks = 600 * TIMER_HZ + 1;
+    for (int t = 0; t < ticks; t++) {
+        timers_tick(&timers);
+    }
+    double tick_ns = (GetTime() - start) * 1e9 / ticks;
+    int bad = 0;
+    for (int i = 0; i < MAX_TIMERS; i++) {
+        bad += i % 4 == 0 ? bts[i].fired != 0 : bts[i].fired != bts[i].due;
+    }
+    printf("timers: %d timers  %6.1f ns to schedule  %6.1f ns per tick  %s\n", MAX_TIMERS, schedule_ns, tick_ns, bad ? "MISMATCH" : "ok");
+    timers = (TimerWheel){0};
+}
+
+// Flies the player straight up 10^7 px at a constant speed with the camera following it, once in plain float world
+// coordinates and once following the origin, against the same climb done in doubles. At the top it drops onto a
+// platform placed by its absolute height. Following the origin, the player must stay exact, the camera within
+// BENCH_CLIMB_CAM_EPS px and the landing exact.
+#define BENCH_CLIMB_HEIGHT 1e7
+#define BENCH_CLIMB_SPEED 15.75f
+#define BENCH_CLIMB_CAM_EPS (1.0 / 64)
+
+typedef struct BenchClimb {
+    double player_err;
+    double cam_err;
+    bool landed;
+    int frames;
+    uint32_t rebases;
+} BenchClimb;
+
+// `x` is a free column, each run leaves its landing platform behind.
+BenchClimb bench_climb_run(ActorID id, float x, bool follow) {
+    const float dt = 1.0f / 60;
+    BenchClimb r = {0};
+    uint32_t rebases = origin.rebases;
+    double y_ref = -20000;
+    player->pos = (Vector2){x, world_local_y(y_ref)};
+    player->remainder = (Vector2){0};
+    player->aabb = (Rectangle){player->pos.x, player->pos.y, player->size.x, player->size.y};
+    player->contacts->valid = false;
+    actors.vy[id] = actors.fall_speed[id] = -BENCH_CLIMB_SPEED;
+    cam.target = player->pos;
+    double cam_ref = world_abs_y(cam.target.y);
+    for (double top = y_ref - BENCH_CLIMB_HEIGHT; y_ref > top; r.frames++) {
+        actors_update(&actors, &game.broad, &id, 1, dt);
+        player->aabb.y = player->pos.y;
+        y_ref -= BENCH_CLIMB_SPEED;
+        r.player_err = fmax(r.player_err, fabs(world_abs_y(player->pos.y) + player->remainder.y - y_ref));
+        float t = fabsf(player->vel.y) * dt;
+        cam.target = Vector2Lerp(cam.target, player->pos, t);
+        cam_ref += t * (world_abs_y(player->pos.y) - cam_ref);
+        r.cam_err = fmax(r.cam_err, fabs(world_abs_y(cam.target.y) - cam_ref));
+        if (follow) {
+            origin_follow(player->pos.y);
+        }
+    }
+
+    double land = floor((world_abs_y(player->pos.y) + 128) / TILE_SIZE) * TILE_SIZE;
+    game_add_plat(&game, x, world_local_y(land), PT_THREE_WIDE);
+    actors.vy[id] = 0;
+    actors.fall_speed[id] = ACTOR_FALL_SPEED;
+    player->grounded = false;
+    for (int f = 0; f < 600 && !player->grounded; f++) {
+        actors_update(&actors, &game.broad, &id, 1, dt);
+        player->aabb.y = player->pos.y;
+        if (follow) {
+            origin_follow(player->pos.y);
+        }
+    }
+    r.landed = player->grounded && world_abs_y(player->pos.y) + player->size.y == land;
+    r.rebases = origin.rebases - rebases;
+    return r;
+}
+
+void bench_climb(void) {
+    player = player_init();
+    ActorID id = actors_add(&actors, player, NULL, NULL);
+    double start = GetTime();
+    BenchClimb raw = bench_climb_run(id, -480, false);
+    BenchClimb followed = bench_climb_run(id, -416, true);
+    double us = (GetTime() - start) / (raw.frames + followed.frames) * 1e6;
+    bool ok = followed.player_err == 0 && followed.cam_err < BENCH_CLIMB_CAM_EPS && followed.landed;
+    printf("climb: %.0f px in %d frames  %.2f us/frame  %u rebases\n", BENCH_CLIMB_HEIGHT, followed.frames, us, followed.rebases);
+    printf("climb: raw floats: player %.4f px  camera %.4f px  %s  origin: player %.4f px  camera %.4f px  %s  %s\n",
+           raw.player_err, raw.cam_err, raw.landed ? "landed" : "missed", followed.player_err, followed.cam_err,
+           followed.landed ? "landed" : "missed", ok ? "ok" : "MISMATCH");
+}
+
+// The frame's render pipeline (cull, sort, build) over views spread along the crowded level, once on the calling
+// thread and once with the workers. Both must build the same number of commands.
+#define BENCH_VIEWS 64
+
+void bench_render(void) {
+    static Rectangle views[BENCH_VIEWS];
+    for (int v = 0; v < BENCH_VIEWS; v++) {
+        views[v] = (Rectangle){-VIEW_WIDTH / 2 - 16, GetRandomValue(-10000, -VIEW_HEIGHT), VIEW_WIDTH + 32, VIEW_HEIGHT + 32};
+    }
+    bool running = render_pool.running;
+    size_t cmds[2] = {0}, shown = 0;
+    double us[2];
+    for (int k = 0; k < 2; k++) {
+        render_pool.running = k == 1 && running;
+        double start = GetTime();
+        for (int f = 0; f < BENCH_FRAMES; f++) {
+            visible_collect(&render_visible, &game.broad, views[f % BENCH_VIEWS]);
+            render_cmds_build(&render_pool, render_visible.ens, render_visible.cnt);
+            for (int j = 0; j < render_pool.active; j++) {
+                cmds[k] += render_pool.bufs[j].cnt;
+            }
+            shown += k == 0 ? render_visible.cnt : 0;
+        }
+        us[k] = (GetTime() - start) / BENCH_FRAMES * 1e6;
+    }
+    render_pool.running = running;
+    printf("render: %zu visible per frame  main thread %7.1f us/frame  %d workers %7.1f us/frame  %s\n", shown / BENCH_FRAMES,
+           us[0], running ? RENDER_WORKERS : 1, us[1], cmds[0] == cmds[1] ? "ok" : "MISMATCH");
+}
+
+int bench_main(void) {
+    SetRandomSeed(1);
+    sprites_load(&sprites, SPRITES_PATH);
+    clip_walk = sprites_find(&sprites, "boy_walk");
+    tileset = tex_acquire("./assets/tileset_forest.png");
+    coffee = tex_acquire("./assets/coffee.png");
+    trophy = tex_acquire("./assets/gold.png");
+    render_pool_init(&render_pool);
+    const int32_t box_cnts[] = {4, 16, 64};
+    for (size_t i = 0; i < sizeof(box_cnts) / sizeof(box_cnts[0]); i++) {
+        bench_aabb(box_cnts[i]);
+    }
+    bench_timers();
+    game_gen_level(&game, -10000);
+    bench_tiles(&game.broad.tiles);
+    bench_casts(&game.broad);
+    const int32_t sizes[] = {100, 1000, 10000};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        bench_spawn_walkers(&game, sizes[i] - actors.cnt);
+        bench_actors();
+    }
+    bench_activity(56);
+    bench_activity(4600);
+    bench_render();
+    bench_climb();
+    render_pool_shutdown(&render_pool);
+    asset_release(trophy);
+    asset_release(coffee);
+    asset_release(tileset);
+    sprites_unload(&sprites);
+    int32_t live = assets_referenced(&assets);
+    printf("assets: %d of %d still referenced after release  %s\n", live, assets.cnt, live ? "LEAK" : "ok");
+    return 0;
 }
+// ;bench
+#endif
 
 int main(void) {
     SetTraceLogLevel(LOG_WARNING);
-    InitAudioDevice();
+#ifdef Bench
+    SetConfigFlags(FLAG_WINDOW_HIDDEN);
+    InitWindow(1024, 576, "bench");
+    int status = bench_main();
+    CloseWindow();
+    return status;
+#endif
     InitWindow(1024, 576, "I'm drinking black coffee!");
     SetTargetFPS(60);
 #ifdef Debug
@@ -879,53 +4925,43 @@ int main(void) {
     cam.offset = (Vector2){GetScreenWidth() / 2, GetScreenHeight() / 2};
     cam.zoom = 2.0;
 
-    minimapCam = cam;
-
     //: load
-    boyIdle = add_tex("./assets/Boy_idle.png");
-    boyWalk = add_tex("./assets/Boy_walk.png");
-    tileset = add_tex("./assets/tileset_forest.png");
-    coffee = add_tex("./assets/coffee.png");
-    trophy = add_tex("./assets/gold.png");
-
-    jump = LoadSound("./assets/jump.wav");
-    land = LoadSound("./assets/land.wav");
-    pickup = LoadSound("./assets/pop1.wav");
-
-    idle = (Animation){
-        .tex = boyIdle,
-        .speed = 0.25,
-        .frame_cnt = 4,
-        .timer = 0,
-    };
+    sprites_load(&sprites, SPRITES_PATH);
+    clip_idle = sprites_find(&sprites, "boy_idle");
+    clip_walk = sprites_find(&sprites, "boy_walk");
+    tileset = tex_acquire("./assets/tileset_forest.png");
+    coffee = tex_acquire("./assets/coffee.png");
+    trophy = tex_acquire("./assets/gold.png");
 
-    walk = (Animation){
-        .tex = boyWalk,
-        .speed = 0.25,
-        .frame_cnt = 6,
-        .timer = 0,
-    };
+    assets.on_unload = sfx_on_unload;
+    sfx_jump = sfx_add(&sfx_bank, sound_acquire("./assets/jump.wav"), 2, 0.05f);
+    sfx_land = sfx_add(&sfx_bank, sound_acquire("./assets/land.wav"), 0, 0.05f);
+    sfx_pickup = sfx_add(&sfx_bank, sound_acquire("./assets/pop1.wav"), 1, 0);
+    loader_start(&loader);
 
     //: init
     player = player_init();
     data = (Player *)player->user_data;
     player->respawn = (Vector2){0, -25};
-    data->animation = &idle;
-    data->jump_boost_time = 20;
+    data->anim = anim_add(&animator, clip_idle);
+    data->actor = actors_add(&actors, player, NULL, player_die);
+    actors_watch_triggers(&actors, data->actor, onTrigger);
+    player_set_boost(data, JUMP_BOOST_MAX);
 
-    game.ens = arena_alloc(&arena, sizeof(Entity *) * MAX_ENTITIES);
-    game.screen = S_MENU;
+    game.screen = S_LOADING;
 
-    dead_zone = en_collidable(-1000, 10, 2000, 16);
-    dead_zone->is_collidable = false;
+    dead_zone = en_trigger(-1000, 10, 2000, 16);
     dead_zone->id = EID_DEAD_ZONE;
     en_move_y(dead_zone, player->respawn.y + player->aabb.height + 16);
     game_add_en(&game, dead_zone);
 
-    minimap = LoadRenderTexture(GetScreenWidth(), GetScreenHeight());
+    view_init(&view, DYNAMIC_RESOLUTION);
+    render_pool_init(&render_pool);
+    bg_init(&background, tileset, BLACK, BLUE);
+    bg_add_layer(&background, 0.5f, (Color){90, 90, 120, 160}, 10);
+    minimap_init(&minimap, GetScreenWidth() * MINIMAP_SCALE, GetScreenHeight() * MINIMAP_SCALE, MINIMAP_UPDATE_RATE);
 
     inited = false;
-    diff = 0;
 #if defined(PLATFORM_WEB)
     emscripten_set_main_loop(UpdateDrawFrame, 60, 1);
 #else
@@ -933,6 +4969,15 @@ int main(void) {
         UpdateDrawFrame();
     }
 #endif
+    loader_wait(&loader);
+    render_pool_shutdown(&render_pool);
+    latency_report(&latency);
+    sfx_clear(&sfx_bank);
+    asset_release(trophy);
+    asset_release(coffee);
+    asset_release(tileset);
+    sprites_unload(&sprites);
+    music_close(&music);
     CloseAudioDevice();
     CloseWindow();
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include "pack.h"
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Offline asset packer: decodes PNGs to RGBA8 and WAVs to float PCM at the mixer rate and writes them into one
+// bundle the game can upload from without decoding anything.
+// usage: pack <out.pak> <asset>...
+
+static uint32_t align_up(uint32_t x) {
+    return (x + PACK_ALIGN - 1) & ~(uint32_t)(PACK_ALIGN - 1);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s <out.pak> <asset>...\n", argv[0]);
+        return 1;
+    }
+    SetTraceLogLevel(LOG_WARNING);
+
+    int cnt = argc - 2;
+    PackEntry *entries = calloc(cnt, sizeof(PackEntry));
+    void **blobs = calloc(cnt, sizeof(void *));
+    int entry_cnt = 0;
+    uint32_t offset = align_up(sizeof(PackHeader) + cnt * sizeof(PackEntry));
+
+    for (int i = 0; i < cnt; i++) {
+        const char *path = argv[i + 2];
+        PackEntry *e = &entries[entry_cnt];
+        if (strlen(path) >= PACK_PATH_LEN) {
+            fprintf(stderr, "pack: path too long: %s\n", path);
+            return 1;
+        }
+        strcpy(e->path, path);
+
+        if (IsFileExtension(path, ".png")) {
+            Image img = LoadImage(path);
+            if (!IsImageReady(img)) {
+                fprintf(stderr, "pack: failed to load image %s\n", path);
+                return 1;
+            }
+            ImageFormat(&img, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+            e->kind = PK_TEXTURE;
+            e->size = img.width * img.height * 4;
+            e->tex.width = img.width;
+            e->tex.height = img.height;
+            e->tex.format = PIXELFORMAT_UNCOMPRESSED_R8G8B8A8;
+            blobs[entry_cnt] = img.data;
+        } else if (IsFileExtension(path, ".wav;.ogg;.mp3;.qoa;.flac")) {
+            Wave wave = LoadWave(path);
+            if (!IsWaveReady(wave)) {
+                fprintf(stderr, "pack: failed to load sound %s\n", path);
+                return 1;
+            }
+            WaveFormat(&wave, PACK_SAMPLE_RATE, 32, PACK_CHANNELS);
+            e->kind = PK_SOUND;
+            e->size = wave.frameCount * wave.channels * sizeof(float);
+            e->snd.frame_cnt = wave.frameCount;
+            e->snd.sample_rate = wave.sampleRate;
+            e->snd.sample_size = wave.sampleSize;
+            e->snd.channels = wave.channels;
+            blobs[entry_cnt] = wave.data;
+        } else {
+            fprintf(stderr, "pack: skipping %s\n", path);
+            continue;
+        }
+        e->offset = offset;
+        offset = align_up(offset + e->size);
+        entry_cnt++;
+    }
+
+    FILE *f = fopen(argv[1], "wb");
+    if (!f) {
+        fprintf(stderr, "pack: could not open %s\n", argv[1]);
+        return 1;
+    }
+    PackHeader header = {PACK_MAGIC, PACK_VERSION, entry_cnt, 0};
+    fwrite(&header, sizeof(header), 1, f);
+    fwrite(entries, sizeof(PackEntry), cnt, f);
+    for (int i = 0; i < entry_cnt; i++) {
+        static const char zeros[PACK_ALIGN] = {0};
+        long pad = entries[i].offset - ftell(f);
+        fwrite(zeros, 1, pad, f);
+        fwrite(blobs[i], 1, entries[i].size, f);
+    }
+    fclose(f);
+    printf("pack: wrote %d entries (%u bytes) to %s\n", entry_cnt, offset, argv[1]);
+    return 0;
+}
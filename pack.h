@@ -0,0 +1,48 @@
+#ifndef PACK_H_
+#define PACK_H_
+
+#include <stdint.h>
+
+// Layout of assets.pak, written by pack.c and read by the game:
+// PackHeader, `entry_cnt` PackEntry records, then the payloads, each aligned to PACK_ALIGN.
+// Textures are stored as raw RGBA8 pixels and sounds as interleaved 32 bit float PCM, so loading is just an upload.
+#define PACK_MAGIC 0x4b505a50
+#define PACK_VERSION 1
+#define PACK_PATH_LEN 64
+#define PACK_ALIGN 16
+#define PACK_SAMPLE_RATE 48000
+#define PACK_CHANNELS 2
+
+typedef enum PackKind {
+    PK_TEXTURE = 1,
+    PK_SOUND = 2,
+} PackKind;
+
+typedef struct PackHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t entry_cnt;
+    uint32_t reserved;
+} PackHeader;
+
+typedef struct PackEntry {
+    char path[PACK_PATH_LEN];
+    uint32_t kind;
+    uint32_t offset;
+    uint32_t size;
+    union {
+        struct {
+            int32_t width;
+            int32_t height;
+            int32_t format;
+        } tex;
+        struct {
+            uint32_t frame_cnt;
+            uint32_t sample_rate;
+            uint32_t sample_size;
+            uint32_t channels;
+        } snd;
+    };
+} PackEntry;
+
+#endif